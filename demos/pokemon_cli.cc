@@ -47,17 +47,22 @@ import dancing_links;
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <optional>
+#include <ostream>
 #include <set>
 #include <span>
+#include <sstream>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -66,6 +71,9 @@ namespace {
 
 constexpr int max_name_width = 17;
 constexpr int digit_width = 3;
+constexpr int max_depth_limit = 24;
+constexpr size_t pipeline_capacity = 1024;
+constexpr std::streamoff pipeline_flush_bytes = 1 << 16;
 
 constexpr std::string_view nil = "\033[0m";
 constexpr std::string_view ansi_yel = "\033[38;5;11m";
@@ -124,6 +132,8 @@ constexpr auto help_msg =
     D                - The Defense flag to solve the defensive type cover problem. This is the default.
     E                - Solve an Exact cover problem. This the default.
     O                - Solve the overlapping cover problem
+    grouped          - Group solutions by the number of options in each cover.
+    stream           - Print covers while the search runs in the order they are found.
 Example Command:
     ./build/rel/pokemon_cli G1 G2 G3 G4 data/dst/Gen-5-Unova2.dst)";
 
@@ -161,19 +171,115 @@ struct Runner
         Dx::Pokemon_links::Coverage_type::defense};
     Solution_type sol_type{Solution_type::exact};
     Print_style style{Print_style::color};
+    bool grouped{false};
+    bool streamed{false};
+};
+
+/// A cover small enough to copy through the pipeline without allocating.
+struct Cover_row
+{
+    int rank;
+    size_t size;
+    std::array<Dx::Type_encoding, max_depth_limit> types;
+};
+
+/// The solver pushes and the formatter pops. Neither ever takes a lock and
+/// each index is only written by one side so they sit on separate cache lines.
+/// A side that finds the ring full or empty sleeps on the other side's index
+/// until it moves. Closing the ring sets a bit in the tail so a sleeping
+/// formatter wakes for that as well.
+template <class T, size_t Capacity> class Spsc_queue {
+  public:
+    void
+    push(const T &elem)
+    {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        const size_t next = (tail + 1) % Capacity;
+        // The ring is full while the head sits one past the tail.
+        head_.wait(next, std::memory_order_acquire);
+        ring_[tail] = elem;
+        tail_.store(next, std::memory_order_release);
+        tail_.notify_one();
+    }
+
+    void
+    close()
+    {
+        tail_.fetch_or(closed_bit, std::memory_order_release);
+        tail_.notify_one();
+    }
+
+    bool
+    try_pop(T &elem)
+    {
+        return take(tail_.load(std::memory_order_acquire), elem);
+    }
+
+    /// Returns false once the ring is closed and every element was popped.
+    /// The formatter only sleeps on the very tail it saw the ring empty at,
+    /// so a push landing between the check and the wait wakes it at once.
+    bool
+    pop(T &elem)
+    {
+        for (;;)
+        {
+            const size_t tail = tail_.load(std::memory_order_acquire);
+            if (take(tail, elem))
+            {
+                return true;
+            }
+            if (tail & closed_bit)
+            {
+                return false;
+            }
+            tail_.wait(tail, std::memory_order_acquire);
+        }
+    }
+
+  private:
+    static constexpr size_t closed_bit = ~(~size_t{0} >> 1);
+
+    /// Pops the head unless it has caught up to the given tail.
+    bool
+    take(size_t tail, T &elem)
+    {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head == (tail & ~closed_bit))
+        {
+            return false;
+        }
+        elem = ring_[head];
+        head_.store((head + 1) % Capacity, std::memory_order_release);
+        head_.notify_one();
+        return true;
+    }
+
+    std::array<T, Capacity> ring_{};
+    alignas(64) std::atomic<size_t> head_{0};
+    alignas(64) std::atomic<size_t> tail_{0};
 };
 
 int run(std::span<const char *const> args);
 int solve(const Runner &runner);
-void print_types(const Ranked_set<Dx::Type_encoding> &res, Print_style style);
+void print_grouped(Dx::Pokemon_links &links, const Runner &runner,
+                   int depth_limit);
+uint64_t print_streamed(Dx::Pokemon_links &links, const Runner &runner,
+                        int depth_limit);
+void print_table(const std::set<Ranked_set<Dx::Type_encoding>> &result,
+                 Print_style style);
+void print_row(std::ostream &out, int rank,
+               std::span<const Dx::Type_encoding> res, size_t max_set_len,
+               Print_style style);
+void print_types(std::ostream &out, std::span<const Dx::Type_encoding> res,
+                 Print_style style);
 std::string
 generate_type_string(std::pair<std::string_view, std::string_view> name,
                      std::pair<uint64_t, std::optional<uint64_t>> indices,
                      Print_style style);
 void print_prep_message(const Universe_sets &sets, Print_style style);
-void break_line(size_t max_set_len, Table_type t);
-void print_solution_msg(const std::set<Ranked_set<Dx::Type_encoding>> &result,
-                        const Runner &runner);
+void break_line(std::ostream &out, size_t max_set_len, Table_type t);
+void print_solution_msg(uint64_t found, const Runner &runner);
+void print_core(const std::vector<Dx::Type_encoding> &core, Print_style style);
 void help();
 
 } // namespace
@@ -246,6 +352,14 @@ run(const std::span<const char *const> args)
             {
                 runner.style = Print_style::plain;
             }
+            else if (arg_str == "grouped")
+            {
+                runner.grouped = true;
+            }
+            else if (arg_str == "stream")
+            {
+                runner.streamed = true;
+            }
             else if (arg_str == "h")
             {
                 help();
@@ -292,45 +406,183 @@ solve(const Runner &runner)
     print_prep_message(items_options, runner.style);
     const int depth_limit
         = runner.type == Dx::Pokemon_links::Coverage_type::attack ? 24 : 6;
+    if (runner.grouped)
+    {
+        print_grouped(links, runner, depth_limit);
+        print_prep_message(items_options, runner.style);
+        return 0;
+    }
+    if (runner.streamed)
+    {
+        const uint64_t found = print_streamed(links, runner, depth_limit);
+        print_solution_msg(found, runner);
+        if (!found)
+        {
+            print_core(Dx::infeasible_core(
+                           links, depth_limit,
+                           runner.sol_type == Solution_type::overlapping),
+                       runner.style);
+        }
+        print_prep_message(items_options, runner.style);
+        return 0;
+    }
     const std::set<Ranked_set<Dx::Type_encoding>> result
         = runner.sol_type == Solution_type::exact
               ? Dx::exact_cover_stack(links, depth_limit)
               : Dx::overlapping_cover_stack(links, depth_limit);
-    print_solution_msg(result, runner);
+    print_solution_msg(result.size(), runner);
     if (result.empty())
     {
+        print_core(Dx::infeasible_core(
+                       links, depth_limit,
+                       runner.sol_type == Solution_type::overlapping),
+                   runner.style);
         return 0;
     }
+    print_table(result, runner.style);
+    print_solution_msg(result.size(), runner);
+    print_prep_message(items_options, runner.style);
+    return 0;
+}
+
+/// One search fills every group so asking for teams of three, four, and five
+/// costs no more than asking for teams of at most five.
+void
+print_grouped(Dx::Pokemon_links &links, const Runner &runner, int depth_limit)
+{
+    const std::vector<std::set<Ranked_set<Dx::Type_encoding>>> groups
+        = runner.sol_type == Solution_type::exact
+              ? Dx::exact_cover_grouped(links, depth_limit)
+              : Dx::overlapping_cover_grouped(links, depth_limit);
+    for (size_t size = 1; size < groups.size(); ++size)
+    {
+        if (groups[size].empty())
+        {
+            continue;
+        }
+        std::cout << "\nCovers with " << size << " options:\n";
+        print_table(groups[size], runner.style);
+    }
+    for (size_t size = 1; size < groups.size(); ++size)
+    {
+        if (!groups[size].empty())
+        {
+            std::cout << "Found " << groups[size].size() << " covers with "
+                      << size << " options.\n";
+        }
+    }
+}
+
+void
+print_table(const std::set<Ranked_set<Dx::Type_encoding>> &result,
+            Print_style style)
+{
     const auto &largest_ranked_set
         = std::ranges::max(result, [](const Ranked_set<Dx::Type_encoding> &a,
                                       const Ranked_set<Dx::Type_encoding> &b) {
               return a.size() < b.size();
           });
     const size_t max_set_len = largest_ranked_set.size();
-    break_line(max_set_len, Table_type::first);
+    break_line(std::cout, max_set_len, Table_type::first);
     size_t cur_set = 1;
     for (const auto &res : result)
     {
-        std::cout << std::left << std::setw(digit_width) << res.rank();
-        size_t col = res.size();
-        print_types(res, runner.style);
-        while (col < max_set_len)
+        print_row(std::cout, res.rank(), {res.begin(), res.end()}, max_set_len,
+                  style);
+        cur_set == result.size()
+            ? break_line(std::cout, max_set_len, Table_type::last)
+            : break_line(std::cout, max_set_len, Table_type::normal);
+        ++cur_set;
+    }
+}
+
+/// The search and the terminal run at the same time. The solver thread copies
+/// each cover into a ring and moves on while the formatter renders rows into a
+/// buffer and writes it whenever it fills or the ring runs dry. A formatter
+/// with nothing to render sleeps until the solver pushes another row. The
+/// table is as wide as the depth limit so the first row can print before we
+/// know the largest cover. Rows appear in the order they are found, not sorted.
+uint64_t
+print_streamed(Dx::Pokemon_links &links, const Runner &runner, int depth_limit)
+{
+    const auto queue
+        = std::make_unique<Spsc_queue<Cover_row, pipeline_capacity>>();
+    const auto max_set_len = static_cast<size_t>(depth_limit);
+    std::thread formatter([&queue, &runner, max_set_len] {
+        std::ostringstream buffer{};
+        Cover_row row{};
+        bool first = true;
+        const auto render = [&] {
+            break_line(buffer, max_set_len,
+                       first ? Table_type::first : Table_type::normal);
+            first = false;
+            print_row(buffer, row.rank, {row.types.data(), row.size},
+                      max_set_len, runner.style);
+        };
+        const auto flush = [&buffer] {
+            std::cout << buffer.view();
+            buffer.str("");
+        };
+        for (;;)
         {
-            std::cout << "│" << std::left << std::setw(max_name_width) << "";
-            ++col;
+            if (!queue->try_pop(row))
+            {
+                // Nothing to format yet so this is a good time to write.
+                if (buffer.tellp() > 0)
+                {
+                    flush();
+                }
+                if (!queue->pop(row))
+                {
+                    break;
+                }
+            }
+            render();
+            if (buffer.tellp() >= pipeline_flush_bytes)
+            {
+                flush();
+            }
         }
-        std::cout << "│\n";
-        cur_set == result.size() ? break_line(max_set_len, Table_type::last)
-                                 : break_line(max_set_len, Table_type::normal);
-        ++cur_set;
+        if (!first)
+        {
+            break_line(buffer, max_set_len, Table_type::last);
+        }
+        flush();
+        std::cout.flush();
+    });
+    const auto push = [&queue](const Ranked_set<Dx::Type_encoding> &cover) {
+        Cover_row row{cover.rank(), cover.size(), {}};
+        std::ranges::copy(cover, row.types.begin());
+        queue->push(row);
+        return true;
+    };
+    const uint64_t found
+        = runner.sol_type == Solution_type::exact
+              ? Dx::exact_cover_streamed(links, depth_limit, push)
+              : Dx::overlapping_cover_streamed(links, depth_limit, push);
+    queue->close();
+    formatter.join();
+    return found;
+}
+
+void
+print_row(std::ostream &out, int rank, std::span<const Dx::Type_encoding> res,
+          size_t max_set_len, Print_style style)
+{
+    out << std::left << std::setw(digit_width) << rank;
+    size_t col = res.size();
+    print_types(out, res, style);
+    while (col < max_set_len)
+    {
+        out << "│" << std::left << std::setw(max_name_width) << "";
+        ++col;
     }
-    print_solution_msg(result, runner);
-    print_prep_message(items_options, runner.style);
-    return 0;
+    out << "│\n";
 }
 
 void
-print_types(const Ranked_set<Dx::Type_encoding> &res, Print_style style)
+print_types(std::ostream &out, std::span<const Dx::Type_encoding> res,
+            Print_style style)
 {
     for (const auto &t : res)
     {
@@ -351,7 +603,7 @@ print_types(const Ranked_set<Dx::Type_encoding> &res, Print_style style)
         {
             width = max_name_width - static_cast<int>(type_pair.first.size());
         }
-        std::cout << "│" << output << std::setw(width) << "";
+        out << "│" << output << std::setw(width) << "";
     }
 }
 
@@ -455,15 +707,14 @@ print_prep_message(const Universe_sets &sets, Print_style style)
 }
 
 void
-print_solution_msg(const std::set<Ranked_set<Dx::Type_encoding>> &result,
-                   const Runner &runner)
+print_solution_msg(uint64_t found, const Runner &runner)
 {
     std::string msg = {};
     if (runner.style == Print_style::color)
     {
-        msg.append(result.empty() ? ansi_red : ansi_grn)
+        msg.append(found == 0 ? ansi_red : ansi_grn)
             .append("\nFound ")
-            .append(std::to_string(result.size()))
+            .append(std::to_string(found))
             .append(runner.sol_type == Solution_type::exact ? " exact"
                                                             : " overlapping")
             .append(" ranked sets of options that cover specified items.")
@@ -476,7 +727,7 @@ print_solution_msg(const std::set<Ranked_set<Dx::Type_encoding>> &result,
     else
     {
         msg.append("\nFound ")
-            .append(std::to_string(result.size()))
+            .append(std::to_string(found))
             .append(runner.sol_type == Solution_type::exact ? " exact"
                                                             : " overlapping")
             .append(" ranked sets of options that cover specified items.")
@@ -488,20 +739,44 @@ print_solution_msg(const std::set<Ranked_set<Dx::Type_encoding>> &result,
     std::cout << msg;
 }
 
+/// The core names the items to drop, or the gyms to skip, before a search
+/// can succeed. An empty core means only the team rules stood in the way.
 void
-break_line(size_t max_set_len, Table_type t)
+print_core(const std::vector<Dx::Type_encoding> &core, Print_style style)
 {
-    std::cout << std::left << std::setw(digit_width) << "";
+    if (core.empty())
+    {
+        return;
+    }
+    std::cout << "No team within the limit covers these "
+              << std::to_string(core.size()) << " items together:\n\n";
+    for (const auto &type : core)
+    {
+        const std::pair<std::string_view, std::string_view> type_pair
+            = type.decode_type();
+        const std::pair<uint64_t, std::optional<uint64_t>> type_indices
+            = type.decode_indices();
+        const std::string output
+            = generate_type_string(type_pair, type_indices, style);
+        std::cout << output << ", ";
+    }
+    std::cout << "\n\n";
+}
+
+void
+break_line(std::ostream &out, size_t max_set_len, Table_type t)
+{
+    out << std::left << std::setw(digit_width) << "";
     switch (t)
     {
     case Table_type::first:
-        std::cout << "┌";
+        out << "┌";
         break;
     case Table_type::normal:
-        std::cout << "├";
+        out << "├";
         break;
     case Table_type::last:
-        std::cout << "└";
+        out << "└";
         break;
     default:
         std::cerr << "Unknown table type\n";
@@ -510,24 +785,24 @@ break_line(size_t max_set_len, Table_type t)
     {
         for (size_t line = 0; line < max_name_width; ++line)
         {
-            std::cout << "─";
+            out << "─";
         }
         switch (t)
         {
         case Table_type::first:
-            std::cout << (col == max_set_len - 1 ? "┐" : "┬");
+            out << (col == max_set_len - 1 ? "┐" : "┬");
             break;
         case Table_type::normal:
-            std::cout << (col == max_set_len - 1 ? "┤" : "┼");
+            out << (col == max_set_len - 1 ? "┤" : "┼");
             break;
         case Table_type::last:
-            std::cout << (col == max_set_len - 1 ? "┘" : "┴");
+            out << (col == max_set_len - 1 ? "┘" : "┴");
             break;
         default:
             std::cerr << "Unknown table type\n";
         }
     }
-    std::cout << "\n";
+    out << "\n";
 }
 
 void
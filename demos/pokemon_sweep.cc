@@ -0,0 +1,205 @@
+/// Author: Alexander G. Lopez
+/// File: pokemon_sweep.cc
+/// ---------------------
+/// This program answers every cover question we know how to ask about the
+/// maps in one run rather than one pokemon_cli process per question. Every map
+/// is asked about its whole generation and every selection of its gyms. Run it
+/// from the root of the repository.
+///
+/// ./build/rel/pokemon_sweep out=sweep.txt
+///
+/// The above sweeps every map in data/dst for exact defensive and attack
+/// covers. Name the maps, coverage types, and cover kinds to narrow or widen
+/// the sweep. Overlapping covers are many so they must be asked for.
+///
+/// ./build/rel/pokemon_sweep out=sweep.txt data/dst/Gen-1-Kanto.dst D E O
+///
+/// Results are written one line per question with the time each one took.
+import dancing_links;
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Dx = Dancing_links;
+namespace {
+
+constexpr std::string_view all_maps_dir = "data/dst";
+
+constexpr auto help_msg =
+    R"(Pokemon Sweep Usage:
+    h                - Read this help message.
+    out=[FILE]       - The file that receives one line per query. Required.
+    data/dst/map.dst - Add a map to the sweep. Every map in data/dst by default.
+    A                - Sweep attack type covers.
+    D                - Sweep defensive type covers.
+    E                - Sweep exact covers. This is the default.
+    O                - Sweep overlapping covers.
+    threads=[N]      - Size of the thread pool. Hardware threads by default.
+Example Command:
+    ./build/rel/pokemon_sweep out=sweep.txt data/dst/Gen-2-Johto.dst A D E)";
+
+struct Sweep_args
+{
+    std::string out{};
+    std::vector<std::string> maps{};
+    std::vector<Dx::Pokemon_links::Coverage_type> types{};
+    std::vector<bool> overlapping{};
+    unsigned threads{0};
+};
+
+int run(std::span<const char *const> args);
+int sweep(Sweep_args &args);
+void help();
+
+} // namespace
+
+int
+main(int argc, char **argv)
+{
+    const auto args
+        = std::span<const char *const>{argv, static_cast<size_t>(argc)}.subspan(
+            1);
+    if (args.empty())
+    {
+        help();
+        return 0;
+    }
+    return run(args);
+}
+
+namespace {
+
+int
+run(const std::span<const char *const> args)
+{
+    try
+    {
+        Sweep_args sweep_args;
+        for (const auto &arg : args)
+        {
+            const std::string_view arg_str{arg};
+            if (arg_str.starts_with("out="))
+            {
+                sweep_args.out = arg_str.substr(4);
+            }
+            else if (arg_str.starts_with("threads="))
+            {
+                sweep_args.threads
+                    = static_cast<unsigned>(std::stoul(std::string(
+                        arg_str.substr(std::string_view("threads=").size()))));
+            }
+            else if (arg_str.find('/') != std::string::npos)
+            {
+                sweep_args.maps.emplace_back(arg_str);
+            }
+            else if (arg_str == "A")
+            {
+                sweep_args.types.push_back(Dx::Pokemon_links::attack);
+            }
+            else if (arg_str == "D")
+            {
+                sweep_args.types.push_back(Dx::Pokemon_links::defense);
+            }
+            else if (arg_str == "E")
+            {
+                sweep_args.overlapping.push_back(false);
+            }
+            else if (arg_str == "O")
+            {
+                sweep_args.overlapping.push_back(true);
+            }
+            else if (arg_str == "h")
+            {
+                help();
+                return 0;
+            }
+            else
+            {
+                std::cerr << "Unknown argument: " << arg_str << "\n";
+                help();
+                return 1;
+            }
+        }
+        return sweep(sweep_args);
+    } catch (const std::exception &e)
+    {
+        std::cerr << "Pokemon sweep encountered exception: " << e.what()
+                  << "\n";
+        help();
+        return 1;
+    }
+}
+
+int
+sweep(Sweep_args &args)
+{
+    if (args.out.empty())
+    {
+        std::cerr << "No output file given. Add out=[FILE].\n";
+        return 1;
+    }
+    if (args.maps.empty())
+    {
+        for (const auto &entry :
+             std::filesystem::directory_iterator(all_maps_dir))
+        {
+            if (entry.path().extension() == ".dst")
+            {
+                args.maps.push_back(entry.path().string());
+            }
+        }
+        std::ranges::sort(args.maps);
+    }
+    if (args.types.empty())
+    {
+        args.types = {Dx::Pokemon_links::defense, Dx::Pokemon_links::attack};
+    }
+    if (args.overlapping.empty())
+    {
+        args.overlapping = {false};
+    }
+    std::ofstream out(args.out);
+    if (!out.is_open())
+    {
+        std::cerr << "Could not open output file " << args.out << "\n";
+        return 1;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<Dx::Sweep_map> maps{};
+    maps.reserve(args.maps.size());
+    for (const std::string &path : args.maps)
+    {
+        maps.push_back(Dx::load_sweep_map(path));
+    }
+    const std::vector<Dx::Sweep_query> queries
+        = Dx::gray_code_queries(maps, args.types, args.overlapping);
+    const std::vector<Dx::Sweep_result> results
+        = Dx::run_sweep(maps, queries, args.threads);
+    Dx::write_sweep(out, maps, results);
+    const auto stop = std::chrono::steady_clock::now();
+    std::cout << "Answered " << results.size() << " queries across "
+              << maps.size() << " maps in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(stop
+                                                                       - start)
+                     .count()
+              << "ms. Results in " << args.out << "\n";
+    return 0;
+}
+
+void
+help()
+{
+    std::cout << help_msg << "\n";
+}
+
+} // namespace
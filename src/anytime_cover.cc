@@ -0,0 +1,365 @@
+/// Author: Alexander Lopez File: anytime_cover.cc
+/// ----------------------
+/// Dancing links finds every cover but can take minutes to do it. Someone
+/// clicking around a map wants a good team now and a better one a moment
+/// later. The anytime solver builds a cover greedily, choosing the option that
+/// covers the most uncovered items with the best multipliers, and then
+/// improves it with simulated annealing until the time budget runs out. It
+/// reads the links it is given without changing them so whatever items and
+/// options the caller hid stay hidden here too.
+module;
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <utility>
+#include <vector>
+export module dancing_links:anytime_cover;
+import :pokemon_links;
+import :ranked_set;
+import :resistance;
+import :type_encoding;
+
+/////////////////////////////////////////   Exported Interface
+
+export namespace Dancing_links {
+
+struct Anytime_result
+{
+    Ranked_set<Type_encoding> best; // Empty if no cover was found in time.
+    uint64_t improvements;
+    uint64_t steps;
+};
+
+/// @brief anytime_cover finds a good overlapping cover quickly and keeps
+/// improving it until the budget is spent. Each item is scored by the best
+/// multiplier any member of the cover has against it so a rank here may be
+/// better than the rank the exhaustive search reports for the same cover.
+/// Secondary items from team rules are honored as the search honors them. An
+/// uncolored one may be claimed by one option and a colored one by any number
+/// of options that agree on its color.
+/// @param links the links to read. Hidden items and options are respected.
+/// @param choice_limit size of a pokemon team or the number of attacks.
+/// @param budget how long to keep improving the cover.
+/// @param improved called with every better cover found. Return false to stop
+/// early.
+/// @param seed the seed for the random moves of the local search.
+/// @return the best cover found and how much work it took.
+Anytime_result anytime_cover(
+    const Pokemon_links &links, int choice_limit,
+    std::chrono::steady_clock::duration budget,
+    const std::function<bool(const Ranked_set<Type_encoding> &)> &improved
+    = {},
+    uint64_t seed = 0);
+
+} // namespace Dancing_links
+
+////////////////////////////////////////   Implementation
+
+namespace Dancing_links {
+
+namespace {
+
+/// Reading the clock is not free so the annealing schedule only checks it
+/// once every so many moves.
+constexpr uint64_t clock_check_interval = 256;
+constexpr double start_temperature = 8.0;
+constexpr double end_temperature = 0.05;
+
+struct Anytime_option
+{
+    Type_encoding name;
+    std::vector<std::pair<uint64_t, Multiplier>> items;
+    std::vector<std::pair<uint64_t, int32_t>> secondary; // Item and color.
+};
+
+/// The live part of the links in a form that is cheap to score many times.
+struct Anytime_problem
+{
+    uint64_t num_items;
+    uint64_t num_secondary;
+    std::vector<Anytime_option> options;
+    Pokemon_links::Coverage_type type;
+};
+
+Anytime_problem
+read_live_problem(const Pokemon_links &links)
+{
+    const std::vector<Pokemon_links::Poke_link> &nodes = links.links();
+    const std::vector<Pokemon_links::Type_name> &items = links.item_table();
+    const std::vector<Pokemon_links::Encoding_index> &options
+        = links.option_table();
+    const std::vector<int32_t> &colors = links.node_colors();
+    Anytime_problem problem{0, 0, {}, links.get_links_type()};
+
+    // Hidden items have left the item table and secondary items were never
+    // in it. A secondary item is the only kind of header that points to
+    // itself.
+    std::vector<uint64_t> item_of(items.size(), UINT64_MAX);
+    std::vector<uint64_t> secondary_of(items.size(), UINT64_MAX);
+    for (uint64_t i = items[0].right; i != 0; i = items[i].right)
+    {
+        item_of[i] = problem.num_items++;
+    }
+    for (uint64_t i = 1; i < items.size(); ++i)
+    {
+        if (items[i].left == i)
+        {
+            secondary_of[i] = problem.num_secondary++;
+        }
+    }
+    for (uint64_t o = 1; o < options.size(); ++o)
+    {
+        const uint64_t spacer = options[o].index;
+        if (nodes[spacer].tag == Pokemon_links::hidden)
+        {
+            continue;
+        }
+        Anytime_option option{options[o].name, {}, {}};
+        for (uint64_t i = spacer + 1; nodes[i].top_or_len > 0; ++i)
+        {
+            // Nodes outside of a threshold do not count as cover.
+            if (nodes[i].tag == Pokemon_links::hidden)
+            {
+                continue;
+            }
+            const auto top = static_cast<uint64_t>(nodes[i].top_or_len);
+            if (item_of[top] != UINT64_MAX)
+            {
+                option.items.emplace_back(item_of[top], nodes[i].multiplier);
+            }
+            else if (secondary_of[top] != UINT64_MAX)
+            {
+                option.secondary.emplace_back(secondary_of[top],
+                                              colors.empty() ? 0 : colors[i]);
+            }
+        }
+        if (!option.items.empty())
+        {
+            problem.options.push_back(std::move(option));
+        }
+    }
+    return problem;
+}
+
+struct Anytime_score
+{
+    int64_t energy;
+    int rank;
+    bool valid;
+};
+
+/// Scores a selection of options. Lower is always better. Every uncovered
+/// item or disputed secondary item costs more than any rank can so the search
+/// always prefers a valid cover. A secondary item is disputed by a second
+/// claim unless both claims carry the same color.
+class Anytime_scorer {
+  public:
+    explicit Anytime_scorer(const Anytime_problem &problem)
+        : problem_(problem),
+          penalty_(static_cast<int64_t>(problem.num_items) * qdr + 1),
+          best_(problem.num_items), claims_(problem.num_secondary)
+    {}
+
+    [[nodiscard]] Anytime_score
+    score(const std::vector<uint64_t> &chosen)
+    {
+        const bool defense = problem_.type == Pokemon_links::defense;
+        std::ranges::fill(best_, emp);
+        std::ranges::fill(claims_, unclaimed);
+        int64_t conflicts = 0;
+        for (const uint64_t o : chosen)
+        {
+            for (const auto &[item, m] : problem_.options[o].items)
+            {
+                if (best_[item] == emp
+                    || (defense ? m < best_[item] : best_[item] < m))
+                {
+                    best_[item] = m;
+                }
+            }
+            for (const auto &[s, color] : problem_.options[o].secondary)
+            {
+                if (claims_[s] == unclaimed)
+                {
+                    claims_[s] = color;
+                }
+                else
+                {
+                    conflicts += !color || claims_[s] != color;
+                }
+            }
+        }
+        int64_t uncovered = 0;
+        int64_t rank = 0;
+        for (const Multiplier m : best_)
+        {
+            uncovered += m == emp;
+            rank += m;
+        }
+        const int64_t faults = uncovered + conflicts;
+        return {(faults * penalty_) + (defense ? rank : -rank),
+                static_cast<int>(rank), faults == 0};
+    }
+
+  private:
+    // Colors are never negative while the links are at rest.
+    static constexpr int32_t unclaimed = -1;
+    const Anytime_problem &problem_;
+    int64_t penalty_;
+    std::vector<Multiplier> best_;
+    std::vector<int32_t> claims_; // The color of the first claim.
+};
+
+Ranked_set<Type_encoding>
+to_cover(const Anytime_problem &problem, const std::vector<uint64_t> &chosen,
+         int rank)
+{
+    std::vector<Type_encoding> names{};
+    names.reserve(chosen.size());
+    for (const uint64_t o : chosen)
+    {
+        names.push_back(problem.options[o].name);
+    }
+    return {rank, std::move(names)};
+}
+
+} // namespace
+
+Anytime_result
+anytime_cover(
+    const Pokemon_links &links, int choice_limit,
+    std::chrono::steady_clock::duration budget,
+    const std::function<bool(const Ranked_set<Type_encoding> &)> &improved,
+    uint64_t seed)
+{
+    const auto start = std::chrono::steady_clock::now();
+    Anytime_result result{{}, 0, 0};
+    const Anytime_problem problem = read_live_problem(links);
+    const uint64_t limit = std::min<uint64_t>(std::max(choice_limit, 0),
+                                              problem.options.size());
+    if (!limit || !problem.num_items)
+    {
+        return result;
+    }
+    Anytime_scorer scorer(problem);
+    std::vector<uint64_t> chosen{};
+    std::vector<bool> in_cover(problem.options.size(), false);
+    int64_t best_energy = INT64_MAX;
+    bool keep_going = true;
+    const auto record = [&](const Anytime_score &current) {
+        if (!current.valid || best_energy <= current.energy)
+        {
+            return;
+        }
+        best_energy = current.energy;
+        result.best = to_cover(problem, chosen, current.rank);
+        ++result.improvements;
+        if (improved && !improved(result.best))
+        {
+            keep_going = false;
+        }
+    };
+
+    // Greedy construction adds whichever option lowers the energy most. The
+    // energy rewards newly covered items first and better multipliers second.
+    Anytime_score current = scorer.score(chosen);
+    while (chosen.size() < limit && !current.valid)
+    {
+        uint64_t pick = problem.options.size();
+        Anytime_score pick_score = current;
+        for (uint64_t o = 0; o < problem.options.size(); ++o)
+        {
+            if (in_cover[o])
+            {
+                continue;
+            }
+            chosen.push_back(o);
+            const Anytime_score s = scorer.score(chosen);
+            chosen.pop_back();
+            if (s.energy < pick_score.energy)
+            {
+                pick = o;
+                pick_score = s;
+            }
+        }
+        if (pick == problem.options.size())
+        {
+            break;
+        }
+        chosen.push_back(pick);
+        in_cover[pick] = true;
+        current = pick_score;
+    }
+    record(current);
+
+    // Simulated annealing. A move swaps a member for an outsider, adds an
+    // outsider, or drops a member. Worse selections are accepted with a
+    // probability that falls as the budget is spent.
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> coin(0.0, 1.0);
+    double temperature = start_temperature;
+    const double seconds = std::chrono::duration<double>(budget).count();
+    while (keep_going)
+    {
+        if (result.steps % clock_check_interval == 0)
+        {
+            const double spent
+                = std::chrono::duration<double>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+            if (spent >= seconds)
+            {
+                break;
+            }
+            temperature = start_temperature
+                          * std::pow(end_temperature / start_temperature,
+                                     spent / seconds);
+        }
+        ++result.steps;
+        const uint64_t outsider = rng() % problem.options.size();
+        const double kind = coin(rng);
+        std::vector<uint64_t> next = chosen;
+        if (!in_cover[outsider] && chosen.size() < limit && kind < 0.2)
+        {
+            next.push_back(outsider);
+        }
+        else if (chosen.size() > 1 && kind < 0.4)
+        {
+            next.erase(next.begin()
+                       + static_cast<int64_t>(rng() % next.size()));
+        }
+        else if (!in_cover[outsider] && !chosen.empty())
+        {
+            next[rng() % next.size()] = outsider;
+        }
+        else
+        {
+            continue;
+        }
+        const Anytime_score next_score = scorer.score(next);
+        const int64_t delta = next_score.energy - current.energy;
+        if (delta > 0
+            && coin(rng)
+                   >= std::exp(-static_cast<double>(delta) / temperature))
+        {
+            continue;
+        }
+        for (const uint64_t o : chosen)
+        {
+            in_cover[o] = false;
+        }
+        chosen = std::move(next);
+        for (const uint64_t o : chosen)
+        {
+            in_cover[o] = true;
+        }
+        current = next_score;
+        record(current);
+    }
+    return result;
+}
+
+} // namespace Dancing_links
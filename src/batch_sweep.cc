@@ -0,0 +1,344 @@
+/// Author: Alexander Lopez File: batch_sweep.cc
+/// ----------------------
+/// A sweep answers many cover questions about many maps at once. Every map is
+/// loaded once and every pair of map and coverage type builds its links once
+/// as a shared template. Queries are handed to a pool of threads in chunks and
+/// each thread keeps its own working links between queries. Gym selections
+/// for a map are visited in Gray code order so that two queries in a row
+/// differ by a single gym and the live items of the working links only change
+/// by the types that gym brings or takes away.
+module;
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+export module dancing_links:batch_sweep;
+import :links_template;
+import :pokemon_links;
+import :pokemon_parser;
+import :ranked_set;
+import :resistance;
+import :type_encoding;
+
+/////////////////////////////////////////   Exported Interface
+
+export namespace Dancing_links {
+
+/// Everything a sweep needs to know about one map, loaded once.
+struct Sweep_map
+{
+    std::string name;
+    std::map<Type_encoding, std::set<Resistance>> interactions;
+    std::vector<std::string> gyms;
+    std::vector<Gym_types> gym_types;
+};
+
+/// One cell of the query matrix. The gyms are a bit set over the gyms of the
+/// map in the order they were loaded. No gyms means the whole generation.
+struct Sweep_query
+{
+    uint64_t map;
+    Pokemon_links::Coverage_type type;
+    bool overlapping;
+    uint64_t gyms;
+};
+
+struct Sweep_result
+{
+    Sweep_query query;
+    uint64_t covers;
+    uint64_t smallest_cover;
+    int best_rank;
+    bool hit_limit;
+    std::chrono::nanoseconds elapsed;
+};
+
+/// @brief load_sweep_map loads the generation and every gym for a map file.
+/// Throws a runtime_error naming the path if the file cannot be opened.
+/// @param path_to_dst the path to the .dst file of the map.
+/// @return the map ready to be swept.
+Sweep_map load_sweep_map(const std::string &path_to_dst);
+
+/// @brief gray_code_queries builds the full query matrix for the maps. Every
+/// map is asked about the whole generation and then every nonempty selection
+/// of its gyms in Gray code order for each coverage type and cover kind.
+/// Throws a length_error if a map has more gyms than a query can select.
+/// @param maps the maps loaded for the sweep.
+/// @param types the coverage types to ask about.
+/// @param overlapping false for exact covers, true for overlapping covers.
+/// @return the queries in the order they should run.
+std::vector<Sweep_query>
+gray_code_queries(const std::vector<Sweep_map> &maps,
+                  const std::vector<Pokemon_links::Coverage_type> &types,
+                  const std::vector<bool> &overlapping);
+
+/// @brief run_sweep answers every query with a pool of threads. Neighbouring
+/// queries are kept on the same thread so their working links are reused.
+/// @param maps the maps the queries refer to.
+/// @param queries the query matrix, usually from gray_code_queries.
+/// @param threads the size of the thread pool. Zero uses the hardware count.
+/// @return one result per query in the same order as the queries.
+std::vector<Sweep_result> run_sweep(const std::vector<Sweep_map> &maps,
+                                    const std::vector<Sweep_query> &queries,
+                                    unsigned threads);
+
+/// @brief write_sweep writes one line per result in a compact text format.
+/// Each line is the map, D or A, E or O, the gyms joined by commas or * for
+/// the whole generation, the number of covers, the smallest cover, the best
+/// rank, 1 if the output limit was reached, and the time in microseconds.
+/// @param out the stream that receives the results.
+/// @param maps the maps the results refer to.
+/// @param results the results of run_sweep.
+void write_sweep(std::ostream &out, const std::vector<Sweep_map> &maps,
+                 const std::vector<Sweep_result> &results);
+
+} // namespace Dancing_links
+
+////////////////////////////////////////   Implementation
+
+namespace Dancing_links {
+
+namespace {
+
+/// Neighbouring queries in a chunk share a thread and its working links.
+constexpr uint64_t sweep_chunk_size = 32;
+
+struct Sweep_links
+{
+    std::shared_ptr<const Links_template> links;
+    // The item positions in the links that each gym of the map asks for.
+    std::vector<std::vector<uint64_t>> gym_items;
+    uint64_t num_items;
+};
+
+Sweep_links
+build_sweep_links(const Sweep_map &map, Pokemon_links::Coverage_type type)
+{
+    Sweep_links result{make_links_template(map.interactions, type), {}, 0};
+    const std::vector<Type_encoding> items
+        = result.links->pristine().get_items();
+    result.num_items = items.size();
+    for (const Gym_types &gym : map.gym_types)
+    {
+        // A defensive team covers the attacks of a gym while attacks cover the
+        // typings found at the gym.
+        const std::set<Type_encoding> &wanted
+            = type == Pokemon_links::defense ? gym.attack : gym.defense;
+        std::vector<uint64_t> &positions = result.gym_items.emplace_back();
+        for (const Type_encoding &t : wanted)
+        {
+            const auto found = std::ranges::lower_bound(items, t);
+            if (found != items.end() && *found == t)
+            {
+                positions.push_back(found - items.begin());
+            }
+        }
+    }
+    return result;
+}
+
+void
+live_gym_items(const Sweep_links &links, uint64_t gyms,
+               std::vector<bool> &live)
+{
+    live.assign(links.num_items, !gyms);
+    for (uint64_t gym = 0; gyms; ++gym, gyms >>= 1)
+    {
+        if (gyms & 1)
+        {
+            for (const uint64_t i : links.gym_items[gym])
+            {
+                live[i] = true;
+            }
+        }
+    }
+}
+
+Sweep_result
+answer_query(Pokemon_links &working, const Sweep_query &query)
+{
+    const int depth_limit = query.type == Pokemon_links::attack ? 24 : 6;
+    const auto start = std::chrono::steady_clock::now();
+    const std::set<Ranked_set<Type_encoding>> covers
+        = query.overlapping ? working.overlapping_coverages_stack(depth_limit)
+                            : working.exact_coverages_stack(depth_limit);
+    const auto stop = std::chrono::steady_clock::now();
+    Sweep_result result{query, covers.size(), 0, 0,
+                        working.reached_output_limit(), stop - start};
+    if (!covers.empty())
+    {
+        const auto sizes = [](const auto &c) { return c.size(); };
+        result.smallest_cover = std::ranges::min(covers, {}, sizes).size();
+        // Lower ranks are better defenses while higher ranks hit harder.
+        const auto ranks = [](const auto &c) { return c.rank(); };
+        result.best_rank = query.type == Pokemon_links::defense
+                               ? std::ranges::min(covers, {}, ranks).rank()
+                               : std::ranges::max(covers, {}, ranks).rank();
+    }
+    return result;
+}
+
+} // namespace
+
+Sweep_map
+load_sweep_map(const std::string &path_to_dst)
+{
+    Sweep_map result{};
+    result.name = path_to_dst.substr(path_to_dst.find_last_of('/') + 1);
+    std::ifstream dst(path_to_dst);
+    if (!dst.is_open())
+    {
+        throw std::runtime_error("Could not open map file " + path_to_dst);
+    }
+    result.interactions = load_interaction_map(dst);
+    for (auto &[gym, types] : load_map_gyms(result.name))
+    {
+        result.gyms.push_back(gym);
+        result.gym_types.push_back(std::move(types));
+    }
+    return result;
+}
+
+std::vector<Sweep_query>
+gray_code_queries(const std::vector<Sweep_map> &maps,
+                  const std::vector<Pokemon_links::Coverage_type> &types,
+                  const std::vector<bool> &overlapping)
+{
+    std::vector<Sweep_query> queries{};
+    for (uint64_t map = 0; map < maps.size(); ++map)
+    {
+        // Gyms are selected by the bits of one word and every selection of
+        // them is a query so the shift must stay inside that word.
+        if (maps[map].gyms.size() >= 64)
+        {
+            throw std::length_error(maps[map].name
+                                    + " has too many gyms to sweep");
+        }
+        const uint64_t subsets = uint64_t{1} << maps[map].gyms.size();
+        for (const Pokemon_links::Coverage_type type : types)
+        {
+            for (const bool overlap : overlapping)
+            {
+                queries.push_back({map, type, overlap, 0});
+                for (uint64_t i = 1; i < subsets; ++i)
+                {
+                    queries.push_back({map, type, overlap, i ^ (i >> 1)});
+                }
+            }
+        }
+    }
+    return queries;
+}
+
+std::vector<Sweep_result>
+run_sweep(const std::vector<Sweep_map> &maps,
+          const std::vector<Sweep_query> &queries, unsigned threads)
+{
+    // Every template is built up front so the workers only ever read them.
+    std::map<std::pair<uint64_t, Pokemon_links::Coverage_type>, Sweep_links>
+        templates{};
+    for (const Sweep_query &query : queries)
+    {
+        const auto key = std::make_pair(query.map, query.type);
+        if (!templates.contains(key))
+        {
+            templates.emplace(key,
+                              build_sweep_links(maps[query.map], query.type));
+        }
+    }
+
+    std::vector<Sweep_result> results(queries.size());
+    std::atomic<uint64_t> next_chunk{0};
+    const uint64_t num_chunks
+        = (queries.size() + sweep_chunk_size - 1) / sweep_chunk_size;
+    const auto worker = [&]() {
+        std::optional<Pokemon_links> working{};
+        const Sweep_links *current = nullptr;
+        std::vector<bool> live{};
+        for (uint64_t chunk = next_chunk++; chunk < num_chunks;
+             chunk = next_chunk++)
+        {
+            const uint64_t end = std::min(queries.size(),
+                                          (chunk + 1) * sweep_chunk_size);
+            for (uint64_t q = chunk * sweep_chunk_size; q < end; ++q)
+            {
+                const Sweep_links &needed
+                    = templates.at({queries[q].map, queries[q].type});
+                if (current != &needed && working)
+                {
+                    needed.links->fork_into(*working);
+                }
+                else if (current != &needed)
+                {
+                    working.emplace(needed.links->fork());
+                }
+                current = &needed;
+                live_gym_items(needed, queries[q].gyms, live);
+                static_cast<void>(working->set_live_items(live));
+                results[q] = answer_query(*working, queries[q]);
+            }
+        }
+    };
+
+    if (!threads)
+    {
+        threads = std::max(1U, std::thread::hardware_concurrency());
+    }
+    std::vector<std::thread> pool{};
+    pool.reserve(threads);
+    for (unsigned t = 0; t < threads; ++t)
+    {
+        pool.emplace_back(worker);
+    }
+    for (std::thread &thread : pool)
+    {
+        thread.join();
+    }
+    return results;
+}
+
+void
+write_sweep(std::ostream &out, const std::vector<Sweep_map> &maps,
+            const std::vector<Sweep_result> &results)
+{
+    out << "# map type cover gyms covers smallest best_rank limit micros\n";
+    for (const Sweep_result &r : results)
+    {
+        const Sweep_map &map = maps[r.query.map];
+        out << map.name << ' '
+            << (r.query.type == Pokemon_links::defense ? 'D' : 'A') << ' '
+            << (r.query.overlapping ? 'O' : 'E') << ' ';
+        if (!r.query.gyms)
+        {
+            out << '*';
+        }
+        bool first = true;
+        for (uint64_t gym = 0; gym < map.gyms.size(); ++gym)
+        {
+            if (r.query.gyms & (uint64_t{1} << gym))
+            {
+                out << (first ? "" : ",") << map.gyms[gym];
+                first = false;
+            }
+        }
+        out << ' ' << r.covers << ' ' << r.smallest_cover << ' '
+            << r.best_rank << ' ' << r.hit_limit << ' '
+            << std::chrono::duration_cast<std::chrono::microseconds>(
+                   r.elapsed)
+                   .count()
+            << '\n';
+    }
+}
+
+} // namespace Dancing_links
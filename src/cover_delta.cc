@@ -0,0 +1,195 @@
+/// Author: Alexander Lopez File: cover_delta.cc
+/// ----------------------
+/// Toggling one gym usually changes a small part of a large answer. Rather
+/// than hand back another full list of covers, the delta reports the covers
+/// that appeared and the covers that vanished. Every cover becomes a bit set
+/// over the option table of the links it came from, stored in one flat array,
+/// with a hash of its words. Both sides are put in a canonical order by hash
+/// and then bits, and one linear merge walks them together. A cover is its
+/// set of options, so a cover whose rank changed between the queries is
+/// neither added nor removed.
+module;
+#include <algorithm>
+#include <cstdint>
+#include <set>
+#include <vector>
+export module dancing_links:cover_delta;
+import :pokemon_links;
+import :ranked_set;
+import :type_encoding;
+
+/////////////////////////////////////////   Exported Interface
+
+export namespace Dancing_links {
+
+struct Cover_delta
+{
+    std::vector<Ranked_set<Type_encoding>> added;   // In after but not before.
+    std::vector<Ranked_set<Type_encoding>> removed; // In before but not after.
+};
+
+/// @brief cover_delta compares the covers of two queries on the same links.
+/// @param links the links both queries ran on. Only the option table is read
+/// so items and options may have been hidden or unhidden in between.
+/// @param before the covers of the earlier query.
+/// @param after the covers of the later query.
+/// @return the covers that appeared and vanished, each in canonical order.
+Cover_delta cover_delta(const Pokemon_links &links,
+                        const std::set<Ranked_set<Type_encoding>> &before,
+                        const std::set<Ranked_set<Type_encoding>> &after);
+
+} // namespace Dancing_links
+
+////////////////////////////////////////   Implementation
+
+namespace Dancing_links {
+
+namespace {
+
+/// Option bit sets of many covers, one fixed width row per cover.
+class Cover_keys {
+  public:
+    Cover_keys(const std::vector<Pokemon_links::Encoding_index> &options,
+               const std::set<Ranked_set<Type_encoding>> &covers)
+        : words_((options.size() + 63) / 64), bits_(words_ * covers.size(), 0)
+    {
+        covers_.reserve(covers.size());
+        hashes_.reserve(covers.size());
+        order_.reserve(covers.size());
+        uint64_t row = 0;
+        for (const Ranked_set<Type_encoding> &cover : covers)
+        {
+            uint64_t *const words = bits_.data() + (row * words_);
+            for (const Type_encoding &member : cover)
+            {
+                // The option table is sorted after its empty header.
+                const auto found = std::lower_bound(
+                    options.begin() + 1, options.end(), member,
+                    [](const Pokemon_links::Encoding_index &option,
+                       Type_encoding name) { return option.name < name; });
+                // Bit 0 is the header and marks a name from other links.
+                const auto bit
+                    = found == options.end() || found->name != member
+                          ? 0
+                          : static_cast<uint64_t>(found - options.begin());
+                words[bit / 64] |= uint64_t{1} << (bit % 64);
+            }
+            uint64_t hash = 0xcbf29ce484222325;
+            for (uint64_t w = 0; w < words_; ++w)
+            {
+                hash = (hash ^ words[w]) * 0x100000001b3;
+            }
+            covers_.push_back(&cover);
+            hashes_.push_back(hash);
+            order_.push_back(row++);
+        }
+        std::ranges::sort(order_, [this](uint64_t a, uint64_t b) {
+            return compare(*this, a, *this, b) < 0;
+        });
+    }
+
+    [[nodiscard]] uint64_t
+    size() const
+    {
+        return order_.size();
+    }
+
+    /// The row at a position in canonical order.
+    [[nodiscard]] uint64_t
+    row(uint64_t position) const
+    {
+        return order_[position];
+    }
+
+    /// Overlapping searches may report one set of options at several ranks.
+    /// They share a key and this skips past all of them.
+    [[nodiscard]] uint64_t
+    next_key(uint64_t position) const
+    {
+        uint64_t next = position + 1;
+        while (next < size()
+               && !compare(*this, row(position), *this, row(next)))
+        {
+            ++next;
+        }
+        return next;
+    }
+
+    [[nodiscard]] const Ranked_set<Type_encoding> &
+    cover(uint64_t index) const
+    {
+        return *covers_[index];
+    }
+
+    /// Orders rows of two key sets built from the same option table.
+    [[nodiscard]] static int
+    compare(const Cover_keys &lhs_keys, uint64_t lhs,
+            const Cover_keys &rhs_keys, uint64_t rhs)
+    {
+        if (lhs_keys.hashes_[lhs] != rhs_keys.hashes_[rhs])
+        {
+            return lhs_keys.hashes_[lhs] < rhs_keys.hashes_[rhs] ? -1 : 1;
+        }
+        const uint64_t *const l
+            = lhs_keys.bits_.data() + (lhs * lhs_keys.words_);
+        const uint64_t *const r
+            = rhs_keys.bits_.data() + (rhs * rhs_keys.words_);
+        for (uint64_t w = 0; w < lhs_keys.words_; ++w)
+        {
+            if (l[w] != r[w])
+            {
+                return l[w] < r[w] ? -1 : 1;
+            }
+        }
+        return 0;
+    }
+
+  private:
+    uint64_t words_;
+    std::vector<uint64_t> bits_;
+    std::vector<uint64_t> hashes_;
+    std::vector<const Ranked_set<Type_encoding> *> covers_;
+    std::vector<uint64_t> order_;
+};
+
+} // namespace
+
+Cover_delta
+cover_delta(const Pokemon_links &links,
+            const std::set<Ranked_set<Type_encoding>> &before,
+            const std::set<Ranked_set<Type_encoding>> &after)
+{
+    const Cover_keys old_keys(links.option_table(), before);
+    const Cover_keys new_keys(links.option_table(), after);
+    Cover_delta delta{};
+    uint64_t o = 0;
+    uint64_t n = 0;
+    while (o < old_keys.size() || n < new_keys.size())
+    {
+        // An exhausted side orders after everything left on the other.
+        int order = o == old_keys.size() ? 1 : -1;
+        if (o < old_keys.size() && n < new_keys.size())
+        {
+            order = Cover_keys::compare(old_keys, old_keys.row(o), new_keys,
+                                        new_keys.row(n));
+        }
+        if (order < 0)
+        {
+            delta.removed.push_back(old_keys.cover(old_keys.row(o)));
+            o = old_keys.next_key(o);
+        }
+        else if (order > 0)
+        {
+            delta.added.push_back(new_keys.cover(new_keys.row(n)));
+            n = new_keys.next_key(n);
+        }
+        else
+        {
+            o = old_keys.next_key(o);
+            n = new_keys.next_key(n);
+        }
+    }
+    return delta;
+}
+
+} // namespace Dancing_links
@@ -0,0 +1,317 @@
+/// Author: Alexander Lopez File: coverage_service.cc
+/// ----------------------
+/// Several threads of one program often ask the same question at the same
+/// moment, such as every panel of a GUI refreshing after one gym is toggled.
+/// The service turns a query into a normal form, the generation, coverage
+/// type, kind of cover, live items, live options, and depth, and answers each
+/// normal form once. A thread asking a question another thread is already
+/// solving waits for that answer instead of starting its own search. Answers
+/// are kept in a least recently used cache of a fixed size and handed out as
+/// shared pointers to immutable sets so no caller copies or owns them alone.
+/// Links for each generation are built once as templates and every solve
+/// forks its own working links from them.
+module;
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <utility>
+#include <vector>
+export module dancing_links:coverage_service;
+import :links_template;
+import :pokemon_links;
+import :ranked_set;
+import :resistance;
+import :type_encoding;
+
+/////////////////////////////////////////   Exported Interface
+
+export namespace Dancing_links {
+
+struct Coverage_query
+{
+    int generation;
+    Pokemon_links::Coverage_type type;
+    bool overlapping;
+    // One entry per item or option of the generation in sorted order, as
+    // set_live_items and set_live_options take them. Empty means all live.
+    std::vector<bool> live_items;
+    std::vector<bool> live_options;
+    int depth;
+};
+
+using Shared_covers
+    = std::shared_ptr<const std::set<Ranked_set<Type_encoding>>>;
+
+class Coverage_service {
+  public:
+    /// @brief Coverage_service answers queries for the generations it is
+    /// given and remembers the answers to the most recent ones.
+    /// @param capacity how many answers to keep. Zero keeps none.
+    explicit Coverage_service(std::size_t capacity);
+
+    /// @brief add_generation builds the links for both coverage types of a
+    /// generation. Adding a generation again replaces it and forgets every
+    /// answer about it. Searches already running on the old links finish for
+    /// the threads waiting on them but their answers are not kept, and later
+    /// queries search the new links.
+    /// @param generation the number queries will use to name it.
+    /// @param interactions the type interactions of the generation.
+    void add_generation(
+        int generation,
+        const std::map<Type_encoding, std::set<Resistance>> &interactions);
+
+    /// @brief solve answers a query from the cache, from a search another
+    /// thread is already running, or with a new search. Safe to call from
+    /// any number of threads.
+    /// @return the covers, or nothing if the generation was never added or a
+    /// mask does not match the size of its links.
+    [[nodiscard]] Shared_covers solve(const Coverage_query &query);
+
+    /// @brief num_solves how many searches the service has run.
+    [[nodiscard]] uint64_t num_solves() const;
+
+    /// @brief num_cached how many answers the cache holds.
+    [[nodiscard]] std::size_t num_cached() const;
+
+  private:
+    struct Key
+    {
+        int generation;
+        Pokemon_links::Coverage_type type;
+        bool overlapping;
+        std::vector<uint64_t> items;
+        std::vector<uint64_t> options;
+        int depth;
+
+        auto operator<=>(const Key &) const = default;
+    };
+
+    struct Entry
+    {
+        Shared_covers covers;
+        std::list<Key>::iterator age;
+    };
+
+    // The template a running search forked from tells it apart from a
+    // search started on the same key after its generation was replaced.
+    struct Flight
+    {
+        std::shared_ptr<const Links_template> links;
+        std::shared_future<Shared_covers> answer;
+    };
+
+    std::size_t capacity_;
+    mutable std::mutex lock_;
+    std::map<std::pair<int, Pokemon_links::Coverage_type>,
+             std::shared_ptr<const Links_template>>
+        templates_{};
+    std::map<Key, Entry> cache_{};
+    std::list<Key> ages_{}; // Most recently used first.
+    std::map<Key, Flight> in_flight_{};
+    uint64_t solves_{0};
+
+    void remember(const Key &key, const Shared_covers &covers);
+    [[nodiscard]] bool
+    land(const Key &key, const std::shared_ptr<const Links_template> &links);
+};
+
+} // namespace Dancing_links
+
+////////////////////////////////////////   Implementation
+
+namespace Dancing_links {
+
+namespace {
+
+/// Packs a mask into words so keys compare quickly. An empty mask is a full
+/// one so both spellings of "everything live" share an answer.
+std::vector<uint64_t>
+pack_mask(const std::vector<bool> &live, uint64_t size)
+{
+    std::vector<uint64_t> words((size + 63) / 64, 0);
+    for (uint64_t i = 0; i < size; ++i)
+    {
+        if (live.empty() || live[i])
+        {
+            words[i / 64] |= uint64_t{1} << (i % 64);
+        }
+    }
+    return words;
+}
+
+} // namespace
+
+Coverage_service::Coverage_service(std::size_t capacity) : capacity_(capacity)
+{}
+
+void
+Coverage_service::add_generation(
+    int generation,
+    const std::map<Type_encoding, std::set<Resistance>> &interactions)
+{
+    // Build outside the lock so queries on other generations keep flowing.
+    std::shared_ptr<const Links_template> defense
+        = make_links_template(interactions, Pokemon_links::defense);
+    std::shared_ptr<const Links_template> attack
+        = make_links_template(interactions, Pokemon_links::attack);
+    const std::lock_guard<std::mutex> guard(lock_);
+    templates_[{generation, Pokemon_links::defense}] = std::move(defense);
+    templates_[{generation, Pokemon_links::attack}] = std::move(attack);
+    for (auto it = ages_.begin(); it != ages_.end();)
+    {
+        if (it->generation == generation)
+        {
+            cache_.erase(*it);
+            it = ages_.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    // New queries must not join a search of the old links. Those searches
+    // see their flight is gone when they finish and keep nothing.
+    std::erase_if(in_flight_, [generation](const auto &flight) {
+        return flight.first.generation == generation;
+    });
+}
+
+Shared_covers
+Coverage_service::solve(const Coverage_query &query)
+{
+    std::shared_ptr<const Links_template> links{};
+    std::promise<Shared_covers> answer{};
+    Key key{};
+    {
+        std::unique_lock<std::mutex> guard(lock_);
+        const auto found = templates_.find({query.generation, query.type});
+        if (found == templates_.end())
+        {
+            return nullptr;
+        }
+        links = found->second;
+        const uint64_t num_items = links->pristine().item_table().size() - 1;
+        const uint64_t num_options
+            = links->pristine().option_table().size() - 1;
+        if ((!query.live_items.empty() && query.live_items.size() != num_items)
+            || (!query.live_options.empty()
+                && query.live_options.size() != num_options))
+        {
+            return nullptr;
+        }
+        key = {query.generation,
+               query.type,
+               query.overlapping,
+               pack_mask(query.live_items, num_items),
+               pack_mask(query.live_options, num_options),
+               query.depth};
+        const auto cached = cache_.find(key);
+        if (cached != cache_.end())
+        {
+            ages_.splice(ages_.begin(), ages_, cached->second.age);
+            return cached->second.covers;
+        }
+        const auto running = in_flight_.find(key);
+        if (running != in_flight_.end())
+        {
+            const std::shared_future<Shared_covers> wait
+                = running->second.answer;
+            // Waiting must happen without the lock or the solver could never
+            // publish its answer.
+            guard.unlock();
+            return wait.get();
+        }
+        in_flight_.emplace(key, Flight{links, answer.get_future().share()});
+        ++solves_;
+    }
+
+    try
+    {
+        Pokemon_links working = links->fork();
+        if (!query.live_items.empty())
+        {
+            static_cast<void>(working.set_live_items(query.live_items));
+        }
+        if (!query.live_options.empty())
+        {
+            static_cast<void>(working.set_live_options(query.live_options));
+        }
+        const auto covers
+            = std::make_shared<const std::set<Ranked_set<Type_encoding>>>(
+                query.overlapping
+                    ? working.overlapping_coverages_stack(query.depth)
+                    : working.exact_coverages_stack(query.depth));
+        {
+            const std::lock_guard<std::mutex> guard(lock_);
+            if (land(key, links))
+            {
+                remember(key, covers);
+            }
+        }
+        answer.set_value(covers);
+        return covers;
+    } catch (...)
+    {
+        {
+            const std::lock_guard<std::mutex> guard(lock_);
+            static_cast<void>(land(key, links));
+        }
+        answer.set_exception(std::current_exception());
+        throw;
+    }
+}
+
+uint64_t
+Coverage_service::num_solves() const
+{
+    const std::lock_guard<std::mutex> guard(lock_);
+    return solves_;
+}
+
+std::size_t
+Coverage_service::num_cached() const
+{
+    const std::lock_guard<std::mutex> guard(lock_);
+    return cache_.size();
+}
+
+/// Ends the flight of a search on the given links. Returns false if its
+/// generation was replaced while it ran, so the answer is stale, in which
+/// case any flight under the key belongs to a newer search and stays.
+bool
+Coverage_service::land(const Key &key,
+                       const std::shared_ptr<const Links_template> &links)
+{
+    const auto flight = in_flight_.find(key);
+    if (flight == in_flight_.end() || flight->second.links != links)
+    {
+        return false;
+    }
+    in_flight_.erase(flight);
+    return true;
+}
+
+void
+Coverage_service::remember(const Key &key, const Shared_covers &covers)
+{
+    if (!capacity_)
+    {
+        return;
+    }
+    ages_.push_front(key);
+    cache_.insert_or_assign(key, Entry{covers, ages_.begin()});
+    if (cache_.size() > capacity_)
+    {
+        cache_.erase(ages_.back());
+        ages_.pop_back();
+    }
+}
+
+} // namespace Dancing_links
@@ -1,8 +1,20 @@
 export module dancing_links;
 
 export import :pokemon_links;
+export import :links_template;
+export import :batch_sweep;
+export import :portfolio;
+export import :anytime_cover;
+export import :team_analysis;
+export import :cover_delta;
+export import :infeasible_core;
+export import :multi_query;
+export import :demand_cover;
+export import :team_packing;
+export import :coverage_service;
 export import :ranked_set;
 export import :type_encoding;
 export import :map_parser;
+export import :json_scan;
 export import :pokemon_parser;
 export import :resistance;
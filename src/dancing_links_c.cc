@@ -0,0 +1,382 @@
+/// Author: Alexander Lopez File: dancing_links_c.cc
+/// ----------------------
+/// The C interface is a thin layer over the module. Handles own ordinary C++
+/// objects and every entry point catches what the library may throw so no
+/// exception crosses into C. Option indices are positions in the option table
+/// of the links, which is sorted and never changes after construction, so a
+/// cover is turned into indices with a binary search per member and written
+/// straight into the buffers of the caller.
+import dancing_links;
+
+#include "dancing_links_c.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <new>
+#include <set>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct dl_generation
+{
+    std::map<Dancing_links::Type_encoding, std::set<Dancing_links::Resistance>>
+        interactions;
+};
+
+struct dl_solver
+{
+    Dancing_links::Pokemon_links links;
+    std::vector<Dancing_links::Type_encoding> items;
+    std::vector<Dancing_links::Type_encoding> options;
+};
+
+namespace {
+
+namespace Dl = Dancing_links;
+
+Dl::Type_encoding
+to_type(dl_type bits)
+{
+    const std::span<const std::string_view> table
+        = Dl::Type_encoding::type_table();
+    if (!bits || std::popcount(bits) > 2 || (bits >> table.size()))
+    {
+        return Dl::Type_encoding(std::string_view{});
+    }
+    std::string name(table[std::countr_zero(bits)]);
+    if (std::popcount(bits) == 2)
+    {
+        name.append("-").append(table[31 - std::countl_zero(bits)]);
+    }
+    return Dl::Type_encoding(name);
+}
+
+/// Returns the position of the type in a sorted table or the table size.
+uint64_t
+index_of(const std::vector<Dl::Type_encoding> &table, Dl::Type_encoding type)
+{
+    const auto found = std::ranges::lower_bound(table, type);
+    if (found == table.end() || *found != type)
+    {
+        return table.size();
+    }
+    return static_cast<uint64_t>(found - table.begin());
+}
+
+/// Every hidden entry stays hidden except the one returning. The links
+/// restore the others in the order they were hidden.
+std::vector<bool>
+live_except(const std::vector<Dl::Type_encoding> &table,
+            const std::vector<Dl::Type_encoding> &hidden,
+            Dl::Type_encoding returning)
+{
+    std::vector<bool> live(table.size(), true);
+    for (const Dl::Type_encoding &h : hidden)
+    {
+        live[index_of(table, h)] = h == returning;
+    }
+    return live;
+}
+
+template <class Body>
+dl_status
+guarded(Body body) noexcept
+{
+    try
+    {
+        return body();
+    } catch (const std::bad_alloc &)
+    {
+        return DL_OUT_OF_MEMORY;
+    } catch (...)
+    {
+        return DL_INVALID_ARGUMENT;
+    }
+}
+
+} // namespace
+
+extern "C" {
+
+dl_type
+dl_type_from_name(const char *name)
+{
+    if (!name)
+    {
+        return 0;
+    }
+    return Dl::Type_encoding(std::string_view{name}).encoding();
+}
+
+size_t
+dl_type_name(dl_type type, char *buffer, size_t size)
+{
+    const std::string name = to_type(type).to_string();
+    if (buffer && size)
+    {
+        const size_t written = std::min(name.size(), size - 1);
+        std::memcpy(buffer, name.data(), written);
+        buffer[written] = '\0';
+    }
+    return name.size();
+}
+
+dl_status
+dl_generation_load_file(const char *path_to_dst, dl_generation **out)
+{
+    if (!path_to_dst || !out)
+    {
+        return DL_INVALID_ARGUMENT;
+    }
+    return guarded([&] {
+        std::ifstream dst(path_to_dst);
+        if (!dst.is_open())
+        {
+            return DL_FILE_ERROR;
+        }
+        *out = new dl_generation{Dl::load_interaction_map(dst)};
+        return DL_OK;
+    });
+}
+
+dl_status
+dl_generation_from_table(const dl_interaction *rows, size_t num_rows,
+                         dl_generation **out)
+{
+    if ((!rows && num_rows) || !out)
+    {
+        return DL_INVALID_ARGUMENT;
+    }
+    return guarded([&] {
+        std::map<Dl::Type_encoding, std::set<Dl::Resistance>> interactions{};
+        for (size_t r = 0; r < num_rows; ++r)
+        {
+            const Dl::Type_encoding defense = to_type(rows[r].defense);
+            const Dl::Type_encoding attack = to_type(rows[r].attack);
+            if (!defense.encoding() || std::popcount(attack.encoding()) != 1
+                || rows[r].multiplier <= DL_EMP || DL_QDR < rows[r].multiplier)
+            {
+                return DL_INVALID_ARGUMENT;
+            }
+            interactions[defense].insert(
+                {attack, static_cast<Dl::Multiplier>(rows[r].multiplier)});
+        }
+        *out = new dl_generation{std::move(interactions)};
+        return DL_OK;
+    });
+}
+
+void
+dl_generation_free(dl_generation *generation)
+{
+    delete generation;
+}
+
+dl_status
+dl_solver_create(const dl_generation *generation, dl_coverage coverage,
+                 dl_solver **out)
+{
+    if (!generation || !out
+        || (coverage != DL_DEFENSE && coverage != DL_ATTACK))
+    {
+        return DL_INVALID_ARGUMENT;
+    }
+    return guarded([&] {
+        Dl::Pokemon_links links(generation->interactions,
+                                coverage == DL_DEFENSE
+                                    ? Dl::Pokemon_links::defense
+                                    : Dl::Pokemon_links::attack);
+        std::vector<Dl::Type_encoding> items{};
+        for (uint64_t i = 1; i < links.item_table().size(); ++i)
+        {
+            items.push_back(links.item_table()[i].name);
+        }
+        std::vector<Dl::Type_encoding> options{};
+        for (uint64_t o = 1; o < links.option_table().size(); ++o)
+        {
+            options.push_back(links.option_table()[o].name);
+        }
+        *out = new dl_solver{std::move(links), std::move(items),
+                             std::move(options)};
+        return DL_OK;
+    });
+}
+
+void
+dl_solver_free(dl_solver *solver)
+{
+    delete solver;
+}
+
+size_t
+dl_solver_num_options(const dl_solver *solver)
+{
+    return solver ? solver->options.size() : 0;
+}
+
+dl_type
+dl_solver_option(const dl_solver *solver, size_t index)
+{
+    if (!solver || index >= solver->options.size())
+    {
+        return 0;
+    }
+    return solver->options[index].encoding();
+}
+
+dl_status
+dl_hide_item(dl_solver *solver, dl_type item)
+{
+    if (!solver)
+    {
+        return DL_INVALID_ARGUMENT;
+    }
+    const Dl::Type_encoding type = to_type(item);
+    if (index_of(solver->items, type) == solver->items.size())
+    {
+        return DL_NOT_FOUND;
+    }
+    return guarded([&] {
+        return solver->links.hide_requested_item(type) ? DL_OK
+                                                       : DL_ALREADY_HIDDEN;
+    });
+}
+
+dl_status
+dl_unhide_item(dl_solver *solver, dl_type item)
+{
+    if (!solver)
+    {
+        return DL_INVALID_ARGUMENT;
+    }
+    const Dl::Type_encoding type = to_type(item);
+    if (index_of(solver->items, type) == solver->items.size())
+    {
+        return DL_NOT_FOUND;
+    }
+    return guarded([&] {
+        const std::vector<Dl::Type_encoding> hidden
+            = solver->links.get_hid_items();
+        if (std::ranges::find(hidden, type) == hidden.end())
+        {
+            return DL_NOT_HIDDEN;
+        }
+        static_cast<void>(solver->links.set_live_items(
+            live_except(solver->items, hidden, type)));
+        return DL_OK;
+    });
+}
+
+dl_status
+dl_hide_option(dl_solver *solver, dl_type option)
+{
+    if (!solver)
+    {
+        return DL_INVALID_ARGUMENT;
+    }
+    const Dl::Type_encoding type = to_type(option);
+    if (index_of(solver->options, type) == solver->options.size())
+    {
+        return DL_NOT_FOUND;
+    }
+    return guarded([&] {
+        return solver->links.hide_requested_option(type) ? DL_OK
+                                                         : DL_ALREADY_HIDDEN;
+    });
+}
+
+dl_status
+dl_unhide_option(dl_solver *solver, dl_type option)
+{
+    if (!solver)
+    {
+        return DL_INVALID_ARGUMENT;
+    }
+    const Dl::Type_encoding type = to_type(option);
+    if (index_of(solver->options, type) == solver->options.size())
+    {
+        return DL_NOT_FOUND;
+    }
+    return guarded([&] {
+        const std::vector<Dl::Type_encoding> hidden
+            = solver->links.get_hid_options();
+        if (std::ranges::find(hidden, type) == hidden.end())
+        {
+            return DL_NOT_HIDDEN;
+        }
+        static_cast<void>(solver->links.set_live_options(
+            live_except(solver->options, hidden, type)));
+        return DL_OK;
+    });
+}
+
+void
+dl_solver_reset(dl_solver *solver)
+{
+    if (solver)
+    {
+        solver->links.reset_items_options();
+    }
+}
+
+dl_status
+dl_solve(dl_solver *solver, dl_query query, int choice_limit,
+         dl_results *results)
+{
+    if (!solver || !results || choice_limit < 0
+        || results->stride < static_cast<size_t>(choice_limit)
+        || results->stride > DL_NO_OPTION
+        || (results->capacity && (!results->options || !results->ranks)))
+    {
+        return DL_INVALID_ARGUMENT;
+    }
+    results->count = 0;
+    return guarded([&] {
+        bool truncated = false;
+        const auto write = [&](const Ranked_set<Dl::Type_encoding> &cover) {
+            if (results->count == results->capacity)
+            {
+                truncated = true;
+                return false;
+            }
+            uint16_t *const slots
+                = results->options + (results->count * results->stride);
+            size_t slot = 0;
+            for (const Dl::Type_encoding &member : cover)
+            {
+                slots[slot++]
+                    = static_cast<uint16_t>(index_of(solver->options, member));
+            }
+            std::fill(slots + slot, slots + results->stride, DL_NO_OPTION);
+            results->ranks[results->count++] = cover.rank();
+            return true;
+        };
+        if (query == DL_OVERLAPPING)
+        {
+            static_cast<void>(
+                solver->links.overlapping_coverages_streamed(choice_limit,
+                                                             write));
+        }
+        else
+        {
+            static_cast<void>(
+                solver->links.exact_coverages_streamed(choice_limit, write));
+        }
+        // The links stop on their own at their output limit even when the
+        // buffers have room, so that is a truncated answer as well.
+        return truncated
+                       || solver->links.get_search_status()
+                              == Dl::Pokemon_links::output_limit
+                   ? DL_TRUNCATED
+                   : DL_OK;
+    });
+}
+
+} // extern "C"
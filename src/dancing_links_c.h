@@ -0,0 +1,165 @@
+/// Author: Alexander Lopez File: dancing_links_c.h
+/// ----------------------
+/// A plain C interface to the Pokemon links for programs that cannot import a
+/// C++ module, such as a GUI written in another language or a scripting
+/// runtime. Everything is reached through opaque handles. A generation holds
+/// the type interactions and is loaded once. A solver holds the links built
+/// from a generation and may be queried any number of times, hiding and
+/// unhiding items and options between queries, so the links are only built
+/// once. Types are passed as the 32 bit encodings the C++ library uses. Query
+/// results are written into buffers the caller owns. Exact queries never
+/// allocate memory per result. Overlapping queries reach the same cover in
+/// many orders and remember every cover they have written to skip repeats, so
+/// their memory grows with the covers found. Link against the shared library
+/// named dancing_links_c.
+#ifndef DANCING_LINKS_C_H
+#define DANCING_LINKS_C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#    if defined(DANCING_LINKS_C_BUILD)
+#        define DL_API __declspec(dllexport)
+#    else
+#        define DL_API __declspec(dllimport)
+#    endif
+#else
+#    define DL_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct dl_generation dl_generation;
+typedef struct dl_solver dl_solver;
+
+/// A single or dual type, one bit per single type in alphabetical order.
+typedef uint32_t dl_type;
+
+typedef enum dl_status
+{
+    DL_OK = 0,
+    DL_INVALID_ARGUMENT, // A null handle or buffer, or a malformed type.
+    DL_FILE_ERROR,       // The generation file could not be opened.
+    DL_NOT_FOUND,        // The item or option is not in the links.
+    DL_ALREADY_HIDDEN,   // Hiding something twice is refused.
+    DL_NOT_HIDDEN,       // Unhiding something that is not hidden is refused.
+    DL_TRUNCATED,        // The result buffers filled before the search ended.
+    DL_OUT_OF_MEMORY
+} dl_status;
+
+typedef enum dl_coverage
+{
+    DL_DEFENSE = 0, // Choose a team of typings that resists attack types.
+    DL_ATTACK       // Choose attack types that hit defensive typings.
+} dl_coverage;
+
+typedef enum dl_query
+{
+    DL_EXACT = 0,
+    DL_OVERLAPPING
+} dl_query;
+
+/// The same values as the Multiplier enum of the C++ library.
+typedef enum dl_multiplier
+{
+    DL_EMP = 0,
+    DL_IMM,
+    DL_F14,
+    DL_F12,
+    DL_NRM,
+    DL_DBL,
+    DL_QDR
+} dl_multiplier;
+
+/// One row of an embedded interaction table. A generation needs a row for
+/// every pairing of defensive typing and single attack type.
+typedef struct dl_interaction
+{
+    dl_type defense;
+    dl_type attack;
+    dl_multiplier multiplier;
+} dl_interaction;
+
+/// Marks the unused slots of a cover smaller than the stride.
+#define DL_NO_OPTION UINT16_MAX
+
+/// Caller owned storage for the covers of one query. Cover c occupies the
+/// slots options[c * stride] through options[c * stride + stride - 1] as
+/// ascending option indices, padded with DL_NO_OPTION, and its rank is
+/// ranks[c]. Option indices may be turned back into types with
+/// dl_solver_option.
+typedef struct dl_results
+{
+    uint16_t *options; // At least capacity * stride entries.
+    int32_t *ranks;    // At least capacity entries.
+    size_t capacity;   // The most covers the buffers can hold.
+    size_t stride;     // Slots per cover. At least the choice limit.
+    size_t count;      // Written by the query. The covers stored.
+} dl_results;
+
+/// @brief dl_type_from_name encodes a type such as "Fire" or "Bug-Flying".
+/// @return the encoding or 0 if the name is not a type.
+DL_API dl_type dl_type_from_name(const char *name);
+
+/// @brief dl_type_name writes the name of a type as a null terminated string.
+/// @return the length of the name, which is only fully written if it is less
+/// than the size of the buffer.
+DL_API size_t dl_type_name(dl_type type, char *buffer, size_t size);
+
+/// @brief dl_generation_load_file reads the generation named on the first
+/// line of a .dst map file, as the GUI does. The type data is read relative
+/// to the working directory, exactly as with the C++ loaders.
+DL_API dl_status dl_generation_load_file(const char *path_to_dst,
+                                         dl_generation **out);
+
+/// @brief dl_generation_from_table builds a generation from rows compiled
+/// into the caller so no files are needed at runtime.
+DL_API dl_status dl_generation_from_table(const dl_interaction *rows,
+                                          size_t num_rows,
+                                          dl_generation **out);
+
+DL_API void dl_generation_free(dl_generation *generation);
+
+/// @brief dl_solver_create builds the links for one kind of coverage. The
+/// solver does not refer to the generation afterwards.
+DL_API dl_status dl_solver_create(const dl_generation *generation,
+                                  dl_coverage coverage, dl_solver **out);
+
+DL_API void dl_solver_free(dl_solver *solver);
+
+/// @brief dl_solver_num_options counts every option, hidden or not. Option
+/// indices run from 0 to this count and never change for a solver.
+DL_API size_t dl_solver_num_options(const dl_solver *solver);
+
+/// @brief dl_solver_option the type an option index stands for.
+/// @return the type or 0 if the index is out of range.
+DL_API dl_type dl_solver_option(const dl_solver *solver, size_t index);
+
+DL_API dl_status dl_hide_item(dl_solver *solver, dl_type item);
+
+DL_API dl_status dl_unhide_item(dl_solver *solver, dl_type item);
+
+DL_API dl_status dl_hide_option(dl_solver *solver, dl_type option);
+
+DL_API dl_status dl_unhide_option(dl_solver *solver, dl_type option);
+
+/// @brief dl_solver_reset returns every hidden item and option.
+DL_API void dl_solver_reset(dl_solver *solver);
+
+/// @brief dl_solve runs one query and writes its covers into the results. If
+/// the buffers fill or the library reaches its own limit on output before the
+/// search ends the search stops, the covers found are kept, and DL_TRUNCATED
+/// is returned. An overlapping query allocates to remember the covers it has
+/// written so far.
+/// @param choice_limit size of a pokemon team or the number of attacks.
+DL_API dl_status dl_solve(dl_solver *solver, dl_query query, int choice_limit,
+                          dl_results *results);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DANCING_LINKS_C_H
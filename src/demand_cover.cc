@@ -0,0 +1,276 @@
+/// Author: Alexander Lopez File: demand_cover.cc
+/// ----------------------
+/// Exact and overlapping covers only ask whether an item is covered. A player
+/// may want more, such as two members that resist Ground or one that is
+/// immune to it. Here every item has a demand and every node of an option
+/// gives a weight from its multiplier. A half resistance gives one, a quarter
+/// resistance two, and an immunity three. A double hit gives one and a quad
+/// hit two. A cover is any set of options within the depth limit whose weights
+/// meet the demand of every item. The search branches on the unmet item with
+/// the fewest options left that could add to it. Options already tried at a
+/// branch are set aside for the rest of that branch so every set is found
+/// once. Every unmet item is checked against the strongest weights still
+/// available for the choices left, and a branch that cannot meet one is cut.
+module;
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+export module dancing_links:demand_cover;
+import :pokemon_links;
+import :ranked_set;
+import :resistance;
+import :type_encoding;
+
+/////////////////////////////////////////   Exported Interface
+
+export namespace Dancing_links {
+
+/// @brief demand_weight the weight a node with a multiplier gives toward the
+/// demand of its item.
+/// @param type the coverage type of the links the node is in.
+/// @param multiplier the multiplier of the node.
+/// @return zero for multipliers that do not help, otherwise one to three.
+[[nodiscard]] int demand_weight(Pokemon_links::Coverage_type type,
+                                Multiplier multiplier);
+
+/// @brief demand_coverages finds sets of at most choice_limit options whose
+/// weights meet the demand of every live item. Every minimal cover, one that
+/// no option can leave, is found. A branch ends as soon as every demand is
+/// met so larger covers that only add options may be left out, though not
+/// every cover reported is minimal. The rank of a cover is the sum of the
+/// multipliers of all its nodes on live items. Team rules on secondary items
+/// are not applied.
+/// @param links the links to read. Hidden items and options are respected.
+/// @param demands the demand of any item that needs more than the default.
+/// Items that are not live are ignored.
+/// @param default_demand the demand of every other live item.
+/// @param choice_limit size of a pokemon team or the number of attacks.
+/// @param max_output the search stops once this many covers are found, the
+/// same cutoff the links use by default.
+/// @return the covers found up to the cutoff.
+std::set<Ranked_set<Type_encoding>>
+demand_coverages(const Pokemon_links &links,
+                 const std::map<Type_encoding, int> &demands,
+                 int default_demand, int choice_limit,
+                 uint64_t max_output = 200'000);
+
+} // namespace Dancing_links
+
+////////////////////////////////////////   Implementation
+
+namespace Dancing_links {
+
+namespace {
+
+struct Demand_option
+{
+    Type_encoding name;
+    std::vector<std::pair<uint64_t, int>> items; // Item and weight.
+    int rank;
+};
+
+class Demand_search {
+  public:
+    Demand_search(const Pokemon_links &links,
+                  const std::map<Type_encoding, int> &demands,
+                  int default_demand)
+    {
+        const std::vector<Pokemon_links::Poke_link> &nodes = links.links();
+        const std::vector<Pokemon_links::Type_name> &items = links.item_table();
+        const std::vector<Pokemon_links::Encoding_index> &options
+            = links.option_table();
+        const Pokemon_links::Coverage_type type = links.get_links_type();
+        std::vector<uint64_t> item_of(items.size(), UINT64_MAX);
+        for (uint64_t i = items[0].right; i != 0; i = items[i].right)
+        {
+            item_of[i] = residual_.size();
+            const auto found = demands.find(items[i].name);
+            residual_.push_back(found == demands.end() ? default_demand
+                                                       : found->second);
+        }
+        columns_.resize(residual_.size());
+        for (uint64_t o = 1; o < options.size(); ++o)
+        {
+            const uint64_t spacer = options[o].index;
+            if (nodes[spacer].tag == Pokemon_links::hidden)
+            {
+                continue;
+            }
+            Demand_option option{options[o].name, {}, 0};
+            for (uint64_t i = spacer + 1; nodes[i].top_or_len > 0; ++i)
+            {
+                const auto top = static_cast<uint64_t>(nodes[i].top_or_len);
+                if (nodes[i].tag == Pokemon_links::hidden
+                    || item_of[top] == UINT64_MAX)
+                {
+                    continue;
+                }
+                option.rank += nodes[i].multiplier;
+                const int weight = demand_weight(type, nodes[i].multiplier);
+                if (weight)
+                {
+                    option.items.emplace_back(item_of[top], weight);
+                }
+            }
+            if (option.items.empty())
+            {
+                continue;
+            }
+            for (const auto &[item, weight] : option.items)
+            {
+                columns_[item].emplace_back(options_.size(), weight);
+            }
+            options_.push_back(std::move(option));
+        }
+        // Strongest weights first so the bound of an item is a prefix sum.
+        for (std::vector<std::pair<uint64_t, int>> &column : columns_)
+        {
+            std::ranges::stable_sort(column, [](const auto &a, const auto &b) {
+                return a.second > b.second;
+            });
+        }
+        unavailable_.assign(options_.size(), false);
+    }
+
+    std::set<Ranked_set<Type_encoding>>
+    run(int choice_limit, uint64_t max_output)
+    {
+        std::set<Ranked_set<Type_encoding>> covers{};
+        max_output_ = max_output;
+        if (choice_limit > 0 && !residual_.empty())
+        {
+            static_cast<void>(search(choice_limit, covers));
+        }
+        return covers;
+    }
+
+  private:
+    std::vector<int> residual_{}; // Demand left for each live item.
+    std::vector<std::vector<std::pair<uint64_t, int>>> columns_{};
+    std::vector<Demand_option> options_{};
+    std::vector<bool> unavailable_{}; // Chosen or set aside at a branch.
+    std::vector<uint64_t> chosen_{};
+    uint64_t max_output_{0};
+
+    /// Returns the unmet item with the fewest options that may add to it or
+    /// the number of items if every demand is met. The flag is false if some
+    /// demand can no longer be met with the choices left.
+    [[nodiscard]] std::pair<uint64_t, bool>
+    choose_item(int left) const
+    {
+        uint64_t best = residual_.size();
+        uint64_t fewest = UINT64_MAX;
+        for (uint64_t item = 0; item < residual_.size(); ++item)
+        {
+            if (residual_[item] <= 0)
+            {
+                continue;
+            }
+            uint64_t available = 0;
+            int bound = 0;
+            for (const auto &[o, weight] : columns_[item])
+            {
+                if (!unavailable_[o])
+                {
+                    bound += static_cast<int>(available) < left ? weight : 0;
+                    ++available;
+                }
+            }
+            if (bound < residual_[item])
+            {
+                return {item, false};
+            }
+            if (available < fewest)
+            {
+                best = item;
+                fewest = available;
+            }
+        }
+        return {best, true};
+    }
+
+    /// Returns false once the output cutoff is reached.
+    [[nodiscard]] bool
+    search(int left, std::set<Ranked_set<Type_encoding>> &covers)
+    {
+        const auto [item, possible] = choose_item(left);
+        if (!possible)
+        {
+            return true;
+        }
+        if (item == residual_.size())
+        {
+            Ranked_set<Type_encoding> cover{};
+            cover.reserve(chosen_.size());
+            for (const uint64_t o : chosen_)
+            {
+                static_cast<void>(
+                    cover.insert(options_[o].rank, options_[o].name));
+            }
+            covers.insert(std::move(cover));
+            return covers.size() < max_output_;
+        }
+        // A set is reached through the first of its options in this column.
+        std::vector<uint64_t> set_aside{};
+        bool more = true;
+        for (const auto &[o, weight] : columns_[item])
+        {
+            if (unavailable_[o])
+            {
+                continue;
+            }
+            unavailable_[o] = true;
+            set_aside.push_back(o);
+            for (const auto &[i, w] : options_[o].items)
+            {
+                residual_[i] -= w;
+            }
+            chosen_.push_back(o);
+            more = search(left - 1, covers);
+            chosen_.pop_back();
+            for (const auto &[i, w] : options_[o].items)
+            {
+                residual_[i] += w;
+            }
+            if (!more)
+            {
+                break;
+            }
+        }
+        for (const uint64_t o : set_aside)
+        {
+            unavailable_[o] = false;
+        }
+        return more;
+    }
+};
+
+} // namespace
+
+int
+demand_weight(Pokemon_links::Coverage_type type, Multiplier multiplier)
+{
+    if (multiplier == emp)
+    {
+        return 0;
+    }
+    if (type == Pokemon_links::defense)
+    {
+        return multiplier < nrm ? nrm - multiplier : 0;
+    }
+    return multiplier > nrm ? multiplier - nrm : 0;
+}
+
+std::set<Ranked_set<Type_encoding>>
+demand_coverages(const Pokemon_links &links,
+                 const std::map<Type_encoding, int> &demands,
+                 int default_demand, int choice_limit, uint64_t max_output)
+{
+    Demand_search search(links, demands, default_demand);
+    return search.run(choice_limit, max_output);
+}
+
+} // namespace Dancing_links
@@ -0,0 +1,281 @@
+/// Author: Alexander Lopez File: infeasible_core.cc
+/// ----------------------
+/// A search that finds nothing only says "Found 0". This finds a minimal set
+/// of items, often just a few gym attack types, that no team within the depth
+/// limit can cover together. It reads the live options of the links as bit
+/// sets over the live items and answers "can these items be covered?" with a
+/// small hitting set search on those bit sets that always branches on the item
+/// with the fewest options left. Starting from every live item, each
+/// item is dropped in turn and stays dropped if what remains still cannot be
+/// covered, so every item left in the core is needed to make it infeasible.
+module;
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <vector>
+export module dancing_links:infeasible_core;
+import :pokemon_links;
+import :type_encoding;
+
+/////////////////////////////////////////   Exported Interface
+
+export namespace Dancing_links {
+
+/// @brief infeasible_core finds a minimal set of live items that cannot be
+/// covered with at most choice_limit options. Hidden items and options are
+/// respected. Team rules on secondary items are not considered so a problem
+/// that only the rules make impossible has no core.
+/// @param links the links whose search found nothing. They are not changed.
+/// @param choice_limit size of a pokemon team or the number of attacks.
+/// @param overlapping true if options may cover the same items.
+/// @return the items of the core, or nothing if the live items can be
+/// covered.
+std::vector<Type_encoding> infeasible_core(const Pokemon_links &links,
+                                           int choice_limit, bool overlapping);
+
+} // namespace Dancing_links
+
+////////////////////////////////////////   Implementation
+
+namespace Dancing_links {
+
+namespace {
+
+/// Every live option as a row of bits over the live items.
+class Core_rows {
+  public:
+    explicit Core_rows(const Pokemon_links &links)
+    {
+        const std::vector<Pokemon_links::Poke_link> &nodes = links.links();
+        const std::vector<Pokemon_links::Type_name> &items = links.item_table();
+        const std::vector<Pokemon_links::Encoding_index> &options
+            = links.option_table();
+        // Hidden items have left the item table and secondary items were
+        // never in it.
+        std::vector<uint64_t> bit_of(items.size(), UINT64_MAX);
+        for (uint64_t i = items[0].right; i != 0; i = items[i].right)
+        {
+            bit_of[i] = names_.size();
+            names_.push_back(items[i].name);
+        }
+        words_ = (names_.size() + 63) / 64;
+        for (uint64_t o = 1; o < options.size(); ++o)
+        {
+            const uint64_t spacer = options[o].index;
+            if (nodes[spacer].tag == Pokemon_links::hidden)
+            {
+                continue;
+            }
+            const uint64_t row = rows_.size();
+            rows_.resize(rows_.size() + words_, 0);
+            for (uint64_t i = spacer + 1; nodes[i].top_or_len > 0; ++i)
+            {
+                const auto top = static_cast<uint64_t>(nodes[i].top_or_len);
+                if (nodes[i].tag != Pokemon_links::hidden
+                    && bit_of[top] != UINT64_MAX)
+                {
+                    rows_[row + (bit_of[top] / 64)] |= uint64_t{1}
+                                                       << (bit_of[top] % 64);
+                }
+            }
+        }
+    }
+
+    [[nodiscard]] uint64_t
+    num_items() const
+    {
+        return names_.size();
+    }
+
+    [[nodiscard]] Type_encoding
+    name(uint64_t item) const
+    {
+        return names_[item];
+    }
+
+    /// @brief coverable true if at most limit options cover every item in
+    /// the set, each exactly once unless overlapping.
+    [[nodiscard]] bool
+    coverable(const std::vector<uint64_t> &set, int limit, bool overlapping)
+    {
+        overlapping_ = overlapping;
+        set_ = set;
+        return search(set, limit);
+    }
+
+    /// @brief options_of counts the options that hold an item.
+    [[nodiscard]] uint64_t
+    options_of(uint64_t item) const
+    {
+        uint64_t count = 0;
+        for (uint64_t row = 0; row < rows_.size(); row += words_)
+        {
+            count += (rows_[row + (item / 64)] >> (item % 64)) & 1;
+        }
+        return count;
+    }
+
+    [[nodiscard]] std::vector<uint64_t>
+    all_items() const
+    {
+        std::vector<uint64_t> set(words_, 0);
+        for (uint64_t i = 0; i < names_.size(); ++i)
+        {
+            set[i / 64] |= uint64_t{1} << (i % 64);
+        }
+        return set;
+    }
+
+  private:
+    std::vector<Type_encoding> names_{};
+    std::vector<uint64_t> rows_{}; // words_ per option.
+    std::vector<uint64_t> set_{};  // The items being asked about.
+    uint64_t words_{0};
+    bool overlapping_{false};
+
+    /// An option may join if it holds the item and, for exact covers, takes
+    /// nothing from the set that is already covered.
+    [[nodiscard]] bool
+    fits(uint64_t row, const std::vector<uint64_t> &uncovered) const
+    {
+        if (overlapping_)
+        {
+            return true;
+        }
+        for (uint64_t w = 0; w < words_; ++w)
+        {
+            if (rows_[row + w] & set_[w] & ~uncovered[w])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    [[nodiscard]] bool
+    search(const std::vector<uint64_t> &uncovered, int limit)
+    {
+        uint64_t left = 0;
+        for (const uint64_t w : uncovered)
+        {
+            left += std::popcount(w);
+        }
+        if (!left)
+        {
+            return true;
+        }
+        if (limit <= 0)
+        {
+            return false;
+        }
+        // Branch on the item the fewest options can still take. The widest
+        // option also bounds how much the remaining choices could cover.
+        uint64_t best_item = UINT64_MAX;
+        uint64_t best_count = UINT64_MAX;
+        uint64_t widest = 0;
+        std::vector<uint64_t> counts(num_items(), 0);
+        for (uint64_t row = 0; row < rows_.size(); row += words_)
+        {
+            if (!fits(row, uncovered))
+            {
+                continue;
+            }
+            uint64_t width = 0;
+            for (uint64_t w = 0; w < words_; ++w)
+            {
+                uint64_t bits = rows_[row + w] & uncovered[w];
+                width += std::popcount(bits);
+                while (bits)
+                {
+                    ++counts[(w * 64) + std::countr_zero(bits)];
+                    bits &= bits - 1;
+                }
+            }
+            widest = std::max(widest, width);
+        }
+        if (widest * static_cast<uint64_t>(limit) < left)
+        {
+            return false;
+        }
+        for (uint64_t i = 0; i < num_items(); ++i)
+        {
+            if (((uncovered[i / 64] >> (i % 64)) & 1) && counts[i] < best_count)
+            {
+                best_item = i;
+                best_count = counts[i];
+            }
+        }
+        if (!best_count)
+        {
+            return false;
+        }
+        std::vector<uint64_t> next(words_, 0);
+        for (uint64_t row = 0; row < rows_.size(); row += words_)
+        {
+            if (!((rows_[row + (best_item / 64)] >> (best_item % 64)) & 1)
+                || !fits(row, uncovered))
+            {
+                continue;
+            }
+            for (uint64_t w = 0; w < words_; ++w)
+            {
+                next[w] = uncovered[w] & ~rows_[row + w];
+            }
+            if (search(next, limit - 1))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+} // namespace
+
+std::vector<Type_encoding>
+infeasible_core(const Pokemon_links &links, int choice_limit, bool overlapping)
+{
+    Core_rows rows(links);
+    std::vector<uint64_t> core = rows.all_items();
+    if (!rows.num_items() || rows.coverable(core, choice_limit, overlapping))
+    {
+        return {};
+    }
+    // An item no option holds is a core on its own.
+    for (uint64_t i = 0; i < rows.num_items(); ++i)
+    {
+        if (!rows.options_of(i))
+        {
+            return {rows.name(i)};
+        }
+    }
+    // Items with many options rarely cause the trouble so try dropping them
+    // first and keep the scarce ones for the core.
+    std::vector<uint64_t> order(rows.num_items());
+    for (uint64_t i = 0; i < order.size(); ++i)
+    {
+        order[i] = i;
+    }
+    std::ranges::stable_sort(order, [&rows](uint64_t a, uint64_t b) {
+        return rows.options_of(a) > rows.options_of(b);
+    });
+    for (const uint64_t i : order)
+    {
+        core[i / 64] &= ~(uint64_t{1} << (i % 64));
+        if (rows.coverable(core, choice_limit, overlapping))
+        {
+            core[i / 64] |= uint64_t{1} << (i % 64);
+        }
+    }
+    std::vector<Type_encoding> result{};
+    for (uint64_t i = 0; i < rows.num_items(); ++i)
+    {
+        if ((core[i / 64] >> (i % 64)) & 1)
+        {
+            result.push_back(rows.name(i));
+        }
+    }
+    return result;
+}
+
+} // namespace Dancing_links
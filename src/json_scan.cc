@@ -0,0 +1,230 @@
+/// Author: Alexander Lopez File: json_scan.cc
+/// ----------------------
+/// The type charts and gym files are small, regular, and read every time a
+/// program starts. Building a full document for them and copying every string
+/// out of it costs more than the search on a small map. This scanner finds
+/// every structural character in one pass over the raw bytes, 64 bytes at a
+/// time, in the style of simdjson. Each block becomes bit masks of quotes and
+/// of the characters {}[]:, and a prefix xor over the quote mask marks the
+/// bytes inside strings so their contents are never mistaken for structure.
+/// The loops over a block are plain byte comparisons that compilers turn into
+/// vector instructions. Parsers then walk the index of structural characters
+/// and read strings as views into the bytes. Escaped strings are not needed
+/// by our data so a file with a backslash is refused and the caller falls
+/// back to a full JSON parser.
+module;
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+export module dancing_links:json_scan;
+
+/////////////////////////////////////////   Exported Interface
+
+export namespace Dancing_links {
+
+class Json_scan {
+  public:
+    /// @brief Json_scan indexes the structural characters of the bytes.
+    /// @param bytes the whole JSON document. The scanner owns them.
+    explicit Json_scan(std::string bytes);
+
+    /// @brief ok false if the document has an unterminated string or an
+    /// escape sequence. Nothing else should be read from a failed scan.
+    [[nodiscard]] bool ok() const;
+
+    /// @brief at_end true once every structural character has been read.
+    [[nodiscard]] bool at_end() const;
+
+    /// @brief peek the next structural character, '"' for a string.
+    /// @return the character or '\0' at the end.
+    [[nodiscard]] char peek() const;
+
+    /// @brief consume moves past the next structural character if it is c.
+    [[nodiscard]] bool consume(char c);
+
+    /// @brief string reads the next string.
+    /// @return the contents between the quotes or nothing if the next token
+    /// is not a string. The view lives as long as the scanner.
+    [[nodiscard]] std::optional<std::string_view> string();
+
+    /// @brief skip_value moves past the next string, object, or array.
+    [[nodiscard]] bool skip_value();
+
+    /// @brief num_structurals the size of the structural index.
+    [[nodiscard]] uint64_t num_structurals() const;
+
+  private:
+    std::string bytes_;
+    std::vector<uint32_t> structurals_;
+    uint64_t cursor_{0};
+    bool ok_{false};
+};
+
+} // namespace Dancing_links
+
+////////////////////////////////////////   Implementation
+
+namespace Dancing_links {
+
+namespace {
+
+constexpr uint64_t block_size = 64;
+
+struct Block_masks
+{
+    uint64_t quotes;
+    uint64_t backslashes;
+    uint64_t operators;
+};
+
+/// Each comparison yields a bit per byte so the loop has no branches.
+Block_masks
+classify(const char *block)
+{
+    Block_masks masks{0, 0, 0};
+    for (uint64_t i = 0; i < block_size; ++i)
+    {
+        const char c = block[i];
+        masks.quotes |= static_cast<uint64_t>(c == '"') << i;
+        masks.backslashes |= static_cast<uint64_t>(c == '\\') << i;
+        masks.operators
+            |= static_cast<uint64_t>(c == '{' || c == '}' || c == '['
+                                     || c == ']' || c == ':' || c == ',')
+               << i;
+    }
+    return masks;
+}
+
+/// Bit i is set if an odd number of quotes lie at or before byte i, meaning
+/// the byte is an opening quote or inside a string.
+uint64_t
+prefix_xor(uint64_t bits)
+{
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+}
+
+} // namespace
+
+Json_scan::Json_scan(std::string bytes) : bytes_(std::move(bytes))
+{
+    if (bytes_.size() >= UINT32_MAX)
+    {
+        return;
+    }
+    structurals_.reserve(bytes_.size() / 4);
+    // In-string state carries across blocks as all ones or all zeros.
+    uint64_t carry = 0;
+    std::array<char, block_size> tail{};
+    for (uint64_t base = 0; base < bytes_.size(); base += block_size)
+    {
+        const char *block = bytes_.data() + base;
+        if (bytes_.size() - base < block_size)
+        {
+            tail.fill(' ');
+            std::memcpy(tail.data(), block, bytes_.size() - base);
+            block = tail.data();
+        }
+        const Block_masks masks = classify(block);
+        if (masks.backslashes)
+        {
+            return;
+        }
+        const uint64_t in_string = prefix_xor(masks.quotes) ^ carry;
+        uint64_t structural
+            = (masks.operators & ~in_string) | (masks.quotes & in_string);
+        carry = 0 - (in_string >> (block_size - 1));
+        while (structural)
+        {
+            structurals_.push_back(
+                static_cast<uint32_t>(base + std::countr_zero(structural)));
+            structural &= structural - 1;
+        }
+    }
+    ok_ = !carry;
+}
+
+bool
+Json_scan::ok() const
+{
+    return ok_;
+}
+
+bool
+Json_scan::at_end() const
+{
+    return cursor_ == structurals_.size();
+}
+
+char
+Json_scan::peek() const
+{
+    return at_end() ? '\0' : bytes_[structurals_[cursor_]];
+}
+
+bool
+Json_scan::consume(char c)
+{
+    if (peek() != c)
+    {
+        return false;
+    }
+    ++cursor_;
+    return true;
+}
+
+std::optional<std::string_view>
+Json_scan::string()
+{
+    if (peek() != '"')
+    {
+        return {};
+    }
+    // Closing quotes are not in the index and strings hold no escapes so the
+    // next quote ends this string.
+    const uint64_t open = structurals_[cursor_++];
+    const uint64_t close = bytes_.find('"', open + 1);
+    return std::string_view(bytes_).substr(open + 1, close - open - 1);
+}
+
+bool
+Json_scan::skip_value()
+{
+    if (peek() == '"')
+    {
+        ++cursor_;
+        return true;
+    }
+    if (peek() != '{' && peek() != '[')
+    {
+        return false;
+    }
+    uint64_t depth = 0;
+    do
+    {
+        const char c = peek();
+        depth += c == '{' || c == '[';
+        depth -= c == '}' || c == ']';
+        ++cursor_;
+    } while (depth && !at_end());
+    return !depth;
+}
+
+uint64_t
+Json_scan::num_structurals() const
+{
+    return structurals_.size();
+}
+
+} // namespace Dancing_links
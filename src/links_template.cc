@@ -0,0 +1,110 @@
+/// Author: Alexander Lopez File: links_template.cc
+/// ----------------------
+/// A Pokemon_links object dances in place so one object can only answer one
+/// query at a time. Building the links for a generation is the expensive part,
+/// so the template builds them once and is then shared, read only, by every
+/// thread or query that needs them. Each query forks its own working links.
+/// Forking into links a thread already owns reuses that storage and the nodes
+/// are plain data, so resetting a pooled instance is a flat copy of the
+/// pristine arrays rather than a rebuild.
+module;
+#include <map>
+#include <memory>
+#include <set>
+#include <type_traits>
+#include <utility>
+export module dancing_links:links_template;
+import :pokemon_links;
+import :resistance;
+import :type_encoding;
+
+/////////////////////////////////////////   Exported Interface
+
+export namespace Dancing_links {
+
+class Links_template {
+  public:
+    /// @brief Links_template builds the pristine links for a generation once.
+    /// @param type_interactions map of pokemon types and their resistances
+    /// to attack types.
+    /// @param requested_cover_solution  ATTACK or DEFENSE.
+    Links_template(
+        const std::map<Type_encoding, std::set<Resistance>> &type_interactions,
+        Pokemon_links::Coverage_type requested_cover_solution);
+
+    /// @brief Links_template adopts links built any other way, such as with
+    /// team rules, thresholds, or hidden items, as the pristine state.
+    /// @param pristine the links every fork starts from.
+    explicit Links_template(Pokemon_links pristine);
+
+    /// @brief fork a new working copy of the pristine links.
+    /// @return links that may be searched and altered freely.
+    [[nodiscard]] Pokemon_links fork() const;
+
+    /// @brief fork_into resets links a caller already owns to the pristine
+    /// state. The storage of the working links is reused so a thread that
+    /// keeps its links between queries never allocates after the first fork.
+    /// @param working links previously forked from this template.
+    void fork_into(Pokemon_links &working) const;
+
+    /// @brief pristine the untouched links shared by every fork.
+    [[nodiscard]] const Pokemon_links &pristine() const;
+
+  private:
+    const Pokemon_links pristine_;
+};
+
+/// @brief make_links_template builds a template ready to be shared between
+/// threads. The template is immutable so sharing it needs no locks.
+/// @param type_interactions map of pokemon types and their resistances
+/// to attack types.
+/// @param requested_cover_solution  ATTACK or DEFENSE.
+/// @return the shared template.
+std::shared_ptr<const Links_template>
+make_links_template(
+    const std::map<Type_encoding, std::set<Resistance>> &type_interactions,
+    Pokemon_links::Coverage_type requested_cover_solution)
+{
+    return std::make_shared<const Links_template>(type_interactions,
+                                                  requested_cover_solution);
+}
+
+} // namespace Dancing_links
+
+////////////////////////////////////////   Implementation
+
+namespace Dancing_links {
+
+Links_template::Links_template(
+    const std::map<Type_encoding, std::set<Resistance>> &type_interactions,
+    Pokemon_links::Coverage_type requested_cover_solution)
+    : pristine_(type_interactions, requested_cover_solution)
+{}
+
+Links_template::Links_template(Pokemon_links pristine)
+    : pristine_(std::move(pristine))
+{}
+
+Pokemon_links
+Links_template::fork() const
+{
+    return pristine_;
+}
+
+void
+Links_template::fork_into(Pokemon_links &working) const
+{
+    // The links are vectors of plain nodes so copy assignment keeps the
+    // capacity working already has and copies each array in one pass.
+    static_assert(std::is_trivially_copyable_v<Pokemon_links::Poke_link>);
+    static_assert(std::is_trivially_copyable_v<Pokemon_links::Type_name>);
+    working = pristine_;
+}
+
+const Pokemon_links &
+Links_template::pristine() const
+{
+    return pristine_;
+}
+
+} // namespace Dancing_links
@@ -0,0 +1,361 @@
+/// Author: Alexander Lopez File: multi_query.cc
+/// ----------------------
+/// A sweep asks one generation about hundreds of gym selections and most of
+/// those searches walk the same options in the same order. This search answers
+/// up to 64 selections in one walk of the option tree. Every node of the walk
+/// carries a 64 bit mask with one bit per query still alive below it. Each
+/// query branches on the first item of its own that is not yet covered, as the
+/// first_item heuristic of the links would, and an option in the column of a
+/// branching item is tried once for every query branching through it. A query
+/// leaves the mask when its items are all covered, when no option it may take
+/// holds its branching item, or when the option being tried is not one its own
+/// search would try. Items and the queries that hold them are bit sets so the
+/// bookkeeping for all queries at a node costs a few word operations per
+/// option.
+module;
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <functional>
+#include <set>
+#include <utility>
+#include <vector>
+export module dancing_links:multi_query;
+import :pokemon_links;
+import :ranked_set;
+import :resistance;
+import :type_encoding;
+
+/////////////////////////////////////////   Exported Interface
+
+export namespace Dancing_links {
+
+/// @brief multi_query_coverages answers many item selections on the same
+/// links, as if the links had been searched once per selection after hiding
+/// every other item. Selections are searched 64 at a time in one traversal.
+/// Exact covers match those of the links. Overlapping covers are those the
+/// links find with the first_item heuristic. Team rules on secondary items
+/// are not applied.
+/// @param links the links to read. Hidden items and options are respected.
+/// @param queries the items each query wants covered. Items that are not
+/// live in the links are ignored and a query with no live items finds nothing.
+/// @param choice_limit size of a pokemon team or the number of attacks.
+/// @param overlapping true if options may cover the same items.
+/// @param visit called with the index of a query and each new cover for it.
+/// Return false to end the stream of that query alone.
+/// @return the number of covers handed to visit for each query.
+std::vector<uint64_t> multi_query_coverages(
+    const Pokemon_links &links,
+    const std::vector<std::set<Type_encoding>> &queries, int choice_limit,
+    bool overlapping,
+    const std::function<bool(uint64_t, const Ranked_set<Type_encoding> &)>
+        &visit);
+
+} // namespace Dancing_links
+
+////////////////////////////////////////   Implementation
+
+namespace Dancing_links {
+
+namespace {
+
+constexpr uint64_t queries_per_walk = 64;
+
+struct Sliced_option
+{
+    Type_encoding name;
+    std::vector<std::pair<uint64_t, Multiplier>> items; // Bit and multiplier.
+    std::vector<uint64_t> bits;
+};
+
+/// Scratch space for one depth of the walk.
+struct Sliced_level
+{
+    std::vector<uint64_t> branch;     // Queries branching on each item.
+    std::vector<uint64_t> candidates; // Options to try at this depth.
+    std::vector<uint64_t> covered;    // Covered items before this depth.
+};
+
+class Sliced_search {
+  public:
+    Sliced_search(const Pokemon_links &links, bool overlapping)
+        : overlapping_(overlapping)
+    {
+        const std::vector<Pokemon_links::Poke_link> &nodes = links.links();
+        const std::vector<Pokemon_links::Type_name> &items = links.item_table();
+        const std::vector<Pokemon_links::Encoding_index> &options
+            = links.option_table();
+        // Exact covers do not depend on the order items are chosen so those
+        // searches may take the scarcest items first. Overlapping covers
+        // follow the order of the item table.
+        std::vector<uint64_t> live{};
+        for (uint64_t i = items[0].right; i != 0; i = items[i].right)
+        {
+            live.push_back(i);
+        }
+        if (!overlapping)
+        {
+            std::ranges::stable_sort(live, [&nodes](uint64_t a, uint64_t b) {
+                return nodes[a].top_or_len < nodes[b].top_or_len;
+            });
+        }
+        std::vector<uint64_t> bit_of(items.size(), UINT64_MAX);
+        for (const uint64_t i : live)
+        {
+            bit_of[i] = names_.size();
+            names_.emplace_back(items[i].name, names_.size());
+        }
+        std::ranges::sort(names_);
+        words_ = (live.size() + 63) / 64;
+        columns_.resize(live.size());
+        for (uint64_t o = 1; o < options.size(); ++o)
+        {
+            const uint64_t spacer = options[o].index;
+            if (nodes[spacer].tag == Pokemon_links::hidden)
+            {
+                continue;
+            }
+            Sliced_option option{options[o].name, {}, {}};
+            option.bits.assign(words_, 0);
+            for (uint64_t i = spacer + 1; nodes[i].top_or_len > 0; ++i)
+            {
+                const auto top = static_cast<uint64_t>(nodes[i].top_or_len);
+                if (nodes[i].tag == Pokemon_links::hidden
+                    || bit_of[top] == UINT64_MAX)
+                {
+                    continue;
+                }
+                option.items.emplace_back(bit_of[top], nodes[i].multiplier);
+                option.bits[bit_of[top] / 64] |= uint64_t{1}
+                                                 << (bit_of[top] % 64);
+            }
+            if (option.items.empty())
+            {
+                continue;
+            }
+            for (const auto &[bit, m] : option.items)
+            {
+                columns_[bit].push_back(options_.size());
+            }
+            options_.push_back(std::move(option));
+        }
+        tried_at_.assign(options_.size(), 0);
+    }
+
+    /// Answers queries first through last - 1 in one walk.
+    void
+    walk(const std::vector<std::set<Type_encoding>> &queries, uint64_t first,
+         uint64_t last, int choice_limit,
+         const std::function<bool(uint64_t, const Ranked_set<Type_encoding> &)>
+             &visit,
+         std::vector<uint64_t> &found)
+    {
+        first_ = first;
+        visit_ = &visit;
+        found_ = &found;
+        stopped_ = 0;
+        holders_.assign(names_.size(), 0);
+        wanted_.assign((last - first) * words_, 0);
+        seen_.assign(last - first, {});
+        uint64_t live = 0;
+        for (uint64_t q = first; q < last; ++q)
+        {
+            for (const Type_encoding &item : queries[q])
+            {
+                const auto found_name = std::ranges::lower_bound(
+                    names_, std::make_pair(item, uint64_t{0}));
+                if (found_name == names_.end() || found_name->first != item)
+                {
+                    continue;
+                }
+                const uint64_t bit = found_name->second;
+                holders_[bit] |= uint64_t{1} << (q - first);
+                wanted_[((q - first) * words_) + (bit / 64)]
+                    |= uint64_t{1} << (bit % 64);
+                live |= uint64_t{1} << (q - first);
+            }
+        }
+        if (!live || choice_limit <= 0)
+        {
+            return;
+        }
+        levels_.resize(static_cast<uint64_t>(choice_limit) + 1);
+        covered_.assign(words_, 0);
+        scored_.assign(words_, 0);
+        path_.clear();
+        coverage_ = {};
+        coverage_.reserve(choice_limit);
+        search(live, choice_limit);
+    }
+
+  private:
+    std::vector<std::pair<Type_encoding, uint64_t>> names_{}; // Name to bit.
+    std::vector<Sliced_option> options_{};
+    std::vector<std::vector<uint64_t>> columns_{}; // Options of each item.
+    std::vector<uint64_t> tried_at_{}; // The node that last tried an option.
+    uint64_t node_{0};
+    uint64_t words_{0};
+    bool overlapping_;
+    // State of one walk.
+    uint64_t first_{0};
+    const std::function<bool(uint64_t, const Ranked_set<Type_encoding> &)>
+        *visit_{nullptr};
+    std::vector<uint64_t> *found_{nullptr};
+    uint64_t stopped_{0};              // Queries whose visitor said stop.
+    std::vector<uint64_t> holders_{};  // Queries that want each item.
+    std::vector<uint64_t> wanted_{};   // Items each query wants.
+    std::vector<std::set<Ranked_set<Type_encoding>>> seen_{};
+    std::vector<Sliced_level> levels_{};
+    std::vector<uint64_t> covered_{};
+    std::vector<uint64_t> path_{};
+    // The options of the path. Only the rank changes from query to query.
+    Ranked_set<Type_encoding> coverage_{};
+    std::vector<uint64_t> scored_{};
+
+    void
+    search(uint64_t live, int limit)
+    {
+        Sliced_level &level = levels_[path_.size()];
+        level.branch.assign(names_.size(), 0);
+        for (uint64_t q_bits = live; q_bits; q_bits &= q_bits - 1)
+        {
+            const auto q = static_cast<uint64_t>(std::countr_zero(q_bits));
+            const uint64_t *const wanted = wanted_.data() + (q * words_);
+            uint64_t w = 0;
+            while (w < words_ && !(wanted[w] & ~covered_[w]))
+            {
+                ++w;
+            }
+            if (w == words_)
+            {
+                // Further options would only make this cover larger.
+                live &= ~(uint64_t{1} << q);
+                report(q);
+                continue;
+            }
+            const auto first_uncovered
+                = (w * 64) + std::countr_zero(wanted[w] & ~covered_[w]);
+            level.branch[first_uncovered] |= uint64_t{1} << q;
+        }
+        live &= ~stopped_;
+        if (!live || !limit)
+        {
+            return;
+        }
+
+        // Only options in the column of some branching item are tried and
+        // each is tried once for every query branching through it.
+        level.candidates.clear();
+        ++node_;
+        for (uint64_t bit = 0; bit < names_.size(); ++bit)
+        {
+            if (!level.branch[bit])
+            {
+                continue;
+            }
+            for (const uint64_t o : columns_[bit])
+            {
+                if (tried_at_[o] != node_)
+                {
+                    tried_at_[o] = node_;
+                    level.candidates.push_back(o);
+                }
+            }
+        }
+        level.covered = covered_;
+        for (const uint64_t o : level.candidates)
+        {
+            // An exact query may not take an option that holds one of its
+            // covered items.
+            uint64_t child = 0;
+            uint64_t conflicts = 0;
+            for (const auto &[bit, m] : options_[o].items)
+            {
+                child |= level.branch[bit];
+                if ((level.covered[bit / 64] >> (bit % 64)) & 1)
+                {
+                    conflicts |= holders_[bit];
+                }
+            }
+            child &= live & ~stopped_;
+            if (!overlapping_)
+            {
+                child &= ~conflicts;
+            }
+            if (!child)
+            {
+                continue;
+            }
+            for (uint64_t w = 0; w < words_; ++w)
+            {
+                covered_[w] |= options_[o].bits[w];
+            }
+            path_.push_back(o);
+            static_cast<void>(coverage_.insert(options_[o].name));
+            search(child, limit - 1);
+            static_cast<void>(coverage_.erase(options_[o].name));
+            path_.pop_back();
+            covered_ = level.covered;
+        }
+    }
+
+    /// Scores the path for one query the way the links would have. Only an
+    /// overlapping cover can reach an item twice and only the first option
+    /// to reach it scores.
+    void
+    report(uint64_t q)
+    {
+        const uint64_t *const wanted = wanted_.data() + (q * words_);
+        std::ranges::fill(scored_, 0);
+        int rank = 0;
+        for (const uint64_t o : path_)
+        {
+            for (const auto &[bit, m] : options_[o].items)
+            {
+                const uint64_t mask = uint64_t{1} << (bit % 64);
+                if ((wanted[bit / 64] & mask) && !(scored_[bit / 64] & mask))
+                {
+                    rank += m;
+                }
+            }
+            for (uint64_t w = 0; overlapping_ && w < words_; ++w)
+            {
+                scored_[w] |= options_[o].bits[w];
+            }
+        }
+        coverage_.add(rank);
+        // Overlapping covers may be reached in several orders.
+        if (!overlapping_ || seen_[q].insert(coverage_).second)
+        {
+            ++(*found_)[first_ + q];
+            if (!(*visit_)(first_ + q, coverage_))
+            {
+                stopped_ |= uint64_t{1} << q;
+            }
+        }
+        coverage_.subtract(rank);
+    }
+};
+
+} // namespace
+
+std::vector<uint64_t>
+multi_query_coverages(
+    const Pokemon_links &links,
+    const std::vector<std::set<Type_encoding>> &queries, int choice_limit,
+    bool overlapping,
+    const std::function<bool(uint64_t, const Ranked_set<Type_encoding> &)>
+        &visit)
+{
+    std::vector<uint64_t> found(queries.size(), 0);
+    Sliced_search search(links, overlapping);
+    for (uint64_t first = 0; first < queries.size(); first += queries_per_walk)
+    {
+        search.walk(queries, first,
+                    std::min(queries.size(), first + queries_per_walk),
+                    choice_limit, visit, found);
+    }
+    return found;
+}
+
+} // namespace Dancing_links
@@ -25,19 +25,27 @@
 /// For a more detailed writeup see the DancingLinks.h file and README.md in
 /// this repository.
 module;
+#include <algorithm>
+#include <chrono>
 #include <climits>
 #include <cmath>
+#include <cstddef>
 #include <cstdint>
 #include <cstdlib>
+#include <functional>
 #include <iostream>
 #include <map>
 #include <optional>
 #include <set>
+#include <stop_token>
+#include <string>
 #include <string_view>
+#include <type_traits>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 export module dancing_links:pokemon_links;
+import :pokemon_parser;
 import :ranked_set;
 import :resistance;
 import :type_encoding;
@@ -83,6 +91,69 @@ class Pokemon_links {
         uint64_t index;
     };
 
+    // Team rules that defensive links can enforce while searching. All but the
+    // last become secondary items that may be covered at most once and need
+    // not be covered at all.
+    enum Rule_type
+    {
+        distinct_types,   // No two members share a single type.
+        one_weak_to,      // At most one member is weak to the rule type.
+        same_weakness_to, // Members weak to the rule type take equal damage.
+        no_quad_weakness  // No member has a x4 weakness to anything.
+    };
+
+    struct Team_rule
+    {
+        Rule_type rule;
+        Type_encoding type{}; // Ignored by rules that concern every type.
+    };
+
+    // How the last search ended. Every status but complete means the results
+    // are partial. The links are always restored no matter how a search ends.
+    enum Search_status
+    {
+        complete,
+        output_limit,
+        cancelled,
+        timed_out
+    };
+
+    // How the next item to cover is chosen. Knuth's fewest options rule is
+    // the default. The others exist because search time can vary wildly with
+    // this choice and no one rule wins every query.
+    enum Item_heuristic
+    {
+        fewest_options,      // Ties go to the first item.
+        fewest_options_last, // Ties go to the last item.
+        first_item           // Items in order as long as all are reachable.
+    };
+
+    // The order options are tried within every item.
+    enum Column_order
+    {
+        built_order,   // Options in lexicographic order as built.
+        reversed_order,
+        score_order    // Strongest resistance or attack first.
+    };
+
+    // What a Pareto search may trade off. Every objective is minimized except
+    // the score of attack links where more damage is better. Weaknesses are
+    // only known for defensive links and are always zero for attack links.
+    enum Objective
+    {
+        team_size,         // Options in the cover.
+        total_score,       // The rank of the cover.
+        shared_weaknesses, // Attack types two or more members are weak to.
+        quad_weaknesses    // The x4 weaknesses of every member summed.
+    };
+
+    struct Pareto_cover
+    {
+        Ranked_set<Type_encoding> cover;
+        std::vector<int> scores; // One per objective in the order requested.
+        bool operator==(const Pareto_cover &rhs) const = default;
+    };
+
     /// @brief Pokemon_links this constructor builds the necessary internal
     /// data structures to run the exact cover via dancing links algorithm.
     /// We need to build differently based on attack or defense. It is
@@ -112,6 +183,63 @@ class Pokemon_links {
         const std::map<Type_encoding, std::set<Resistance>> &type_interactions,
         const std::set<Type_encoding> &attack_types);
 
+    /// @brief Pokemon_links this constructor builds defensive links that
+    /// enforce team rules during the search rather than by filtering results.
+    /// Rules limiting how many members may share a trait become secondary
+    /// items after the primary attack type items. Options may carry a colour
+    /// on a secondary item in which case any number of chosen options may
+    /// share that item as long as they agree on its colour.
+    /// @param type_interactions the map of types and their defenses for a given
+    /// generation.
+    /// @param rules the declarative list of team rules to enforce.
+    explicit Pokemon_links(
+        const std::map<Type_encoding, std::set<Resistance>> &type_interactions,
+        const std::vector<Team_rule> &rules);
+
+    /// @brief Pokemon_links this constructor builds links that hold every
+    /// interaction between types, each tagged with its multiplier, so that
+    /// one structure answers questions for any resistance or damage cutoff.
+    /// Nodes outside of the current threshold are hidden from their items and
+    /// changing the threshold only touches the nodes that change sides.
+    /// @param type_interactions map of pokemon types and their resistances
+    /// to attack types.
+    /// @param requested_cover_solution  ATTACK or DEFENSE. Build a team or
+    /// choose attack types.
+    /// @param threshold the weakest multiplier that still counts as cover.
+    /// Defense counts multipliers at or below it and attack at or above it.
+    explicit Pokemon_links(
+        const std::map<Type_encoding, std::set<Resistance>> &type_interactions,
+        Coverage_type requested_cover_solution, Multiplier threshold);
+
+    /// @brief Pokemon_links this constructor builds defensive links where the
+    /// options are Pokemon species rather than typings. Species that share a
+    /// typing and resist every attack type the same way are collapsed into
+    /// one option that remembers all of their names, so the search is about
+    /// as costly as the typing problem. Abilities that grant immunities give
+    /// a species its own option when its row no longer matches its typing.
+    /// A cover may hold one option of each typing, exactly as with typings.
+    /// @param type_interactions the map of types and their defenses for a given
+    /// generation.
+    /// @param species the species to choose from. Species with a typing that
+    /// does not exist in the generation are left out.
+    explicit Pokemon_links(
+        const std::map<Type_encoding, std::set<Resistance>> &type_interactions,
+        const std::vector<Species> &species);
+
+    /// @brief Pokemon_links this constructor builds one problem across several
+    /// generations so that one search finds covers that hold in every game.
+    /// Each item is an attack type, or a typing for attack links, paired with
+    /// the generation it belongs to. The options are the typings, or attack
+    /// types, that exist in every one of the generations and each option
+    /// carries its interactions from every generation.
+    /// @param generations the interaction maps keyed by generation number.
+    /// @param requested_cover_solution  ATTACK or DEFENSE. Build a team or
+    /// choose attack types.
+    explicit Pokemon_links(
+        const std::map<int, std::map<Type_encoding, std::set<Resistance>>>
+            &generations,
+        Coverage_type requested_cover_solution);
+
     ///////////////////  See Dancing_links.h for Documented Free Functions
 
     [[nodiscard]] std::set<Ranked_set<Type_encoding>>
@@ -126,8 +254,53 @@ class Pokemon_links {
     [[nodiscard]] std::set<Ranked_set<Type_encoding>>
     overlapping_coverages_stack(int choice_limit);
 
+    [[nodiscard]] std::set<Ranked_set<Type_encoding>>
+    exact_coverages_trail(int choice_limit);
+
+    [[nodiscard]] std::set<Ranked_set<Type_encoding>>
+    overlapping_coverages_trail(int choice_limit);
+
+    [[nodiscard]] std::vector<Ranked_set<Type_encoding>>
+    overlapping_coverages_unique(int choice_limit);
+
+    [[nodiscard]] std::vector<std::set<Ranked_set<Type_encoding>>>
+    exact_coverages_grouped(int choice_limit);
+
+    [[nodiscard]] std::vector<std::set<Ranked_set<Type_encoding>>>
+    overlapping_coverages_grouped(int choice_limit);
+
+    [[nodiscard]] std::vector<uint64_t> exact_coverage_counts(int choice_limit);
+
+    uint64_t exact_coverages_streamed(
+        int choice_limit,
+        const std::function<bool(const Ranked_set<Type_encoding> &)> &visit);
+
+    uint64_t overlapping_coverages_streamed(
+        int choice_limit,
+        const std::function<bool(const Ranked_set<Type_encoding> &)> &visit);
+
+    [[nodiscard]] std::vector<Pareto_cover>
+    exact_pareto_coverages(int choice_limit,
+                           const std::vector<Objective> &objectives);
+
+    [[nodiscard]] std::vector<Pareto_cover>
+    overlapping_pareto_coverages(int choice_limit,
+                                 const std::vector<Objective> &objectives);
+
+    [[nodiscard]] std::set<Ranked_set<uint64_t>>
+    exact_species_coverages(int choice_limit);
+
+    [[nodiscard]] std::set<Ranked_set<uint64_t>>
+    overlapping_species_coverages(int choice_limit);
+
+    [[nodiscard]] const std::vector<std::string> &
+    get_option_species(uint64_t option) const;
+
     [[nodiscard]] bool hide_requested_item(Type_encoding to_hide);
 
+    [[nodiscard]] bool hide_requested_item(int generation,
+                                           Type_encoding to_hide);
+
     [[nodiscard]] bool
     hide_requested_item(const std::vector<Type_encoding> &to_hide);
 
@@ -137,6 +310,8 @@ class Pokemon_links {
 
     void hide_all_items_except(const std::set<Type_encoding> &to_keep);
 
+    [[nodiscard]] bool set_live_items(const std::vector<bool> &live);
+
     [[nodiscard]] bool has_item(Type_encoding item) const;
 
     [[nodiscard]] Type_encoding peek_hid_item() const;
@@ -162,6 +337,8 @@ class Pokemon_links {
 
     void hide_all_options_except(const std::set<Type_encoding> &to_keep);
 
+    [[nodiscard]] bool set_live_options(const std::vector<bool> &live);
+
     [[nodiscard]] bool has_option(Type_encoding option) const;
 
     [[nodiscard]] Type_encoding peek_hid_option() const;
@@ -178,8 +355,26 @@ class Pokemon_links {
 
     void reset_items_options();
 
+    [[nodiscard]] bool set_threshold(Multiplier threshold);
+
+    [[nodiscard]] Multiplier get_threshold() const;
+
     [[nodiscard]] bool reached_output_limit() const;
 
+    void set_stop_token(std::stop_token token);
+
+    void set_deadline(std::chrono::steady_clock::time_point deadline);
+
+    void clear_stop_conditions();
+
+    [[nodiscard]] Search_status get_search_status() const;
+
+    void set_output_limit(std::size_t limit);
+
+    void set_item_heuristic(Item_heuristic heuristic);
+
+    void set_column_order(Column_order order);
+
     [[nodiscard]] std::vector<Type_encoding> get_items() const;
 
     [[nodiscard]] uint64_t get_num_items() const;
@@ -194,8 +389,14 @@ class Pokemon_links {
 
     [[nodiscard]] const std::vector<Type_name> &item_table() const;
 
+    [[nodiscard]] const std::vector<int> &item_generations() const;
+
     [[nodiscard]] const std::vector<Encoding_index> &option_table() const;
 
+    /// @brief node_colors the color of every node by index in the links. Zero
+    /// is uncolored. Empty when no team rule colors a secondary item.
+    [[nodiscard]] const std::vector<int32_t> &node_colors() const;
+
   private:
     //////////////////////  Dancing Links Internals and Implementation
 
@@ -211,6 +412,31 @@ class Pokemon_links {
         int tag;
     };
 
+    /// A secondary item an option must include when the links are built.
+    struct Secondary_node
+    {
+        uint64_t header;
+        int32_t color;
+    };
+
+    /// The weaknesses of a defensive option as bits over the primary items.
+    struct Weakness_profile
+    {
+        uint64_t weak;
+        int32_t quads;
+    };
+
+    /// The objectives of the partial cover a Pareto search holds. Undoing an
+    /// option takes back exactly what choosing it added.
+    struct Pareto_state
+    {
+        int32_t size;
+        int32_t score;
+        int32_t shared;
+        int32_t quads;
+        std::vector<uint8_t> weak_counts; // Members weak to each item.
+    };
+
     /// This is how to acheive an explicit stack dancing links algorithm.
     struct Branch
     {
@@ -219,6 +445,15 @@ class Pokemon_links {
         std::optional<Encoding_score> score{};
     };
 
+    /// The length of each trail when a branch of the trail search began.
+    /// Undoing to a mark restores every entry written since.
+    struct Trail_mark
+    {
+        uint64_t nodes;
+        uint64_t items;
+        uint64_t colors;
+    };
+
     /// These data structures contain the core logic of Algorithm X via dancing
     /// links. For more detailed information, see the tests in the
     /// implementation. These help acheive in place recursion. We can also play
@@ -228,14 +463,30 @@ class Pokemon_links {
     /// can find any option or item in O(lgN). No auxillary maps are needed.
     std::vector<Encoding_index> option_table_{}; // Name of the option we chose.
     std::vector<Type_name> item_table_{};        // Names of our items.
+    std::vector<int> item_generations_{};        // By item. Combined only.
     std::vector<Poke_link> links_{};             // The links that dance!
     std::vector<uint64_t> hidden_items_{};       // Stack with dynamic hiding.
     std::vector<uint64_t> hidden_options_{};     // Stack with dynamic hiding.
-    std::size_t max_output_{200'000};            // Cutoff for solution count.
+    std::vector<int32_t> colors_{};              // Secondary node colors.
+    std::vector<Weakness_profile> weaknesses_{}; // By option. Defense only.
+    std::vector<std::vector<std::string>> option_species_{}; // By option.
+    uint64_t secondary_start_{0};                // First secondary header.
+    std::vector<std::vector<uint64_t>> threshold_nodes_{}; // By multiplier.
+    Multiplier threshold_{};                     // Current cutoff if tagged.
+    std::size_t max_output_{200'000};            // Cutoff per solution set.
     bool hit_limit_{false};                      // Remember if cutoff occurs.
+    std::stop_token stop_token_{};               // Caller may cancel a search.
+    std::optional<std::chrono::steady_clock::time_point> deadline_{};
+    Search_status stop_reason_{complete};        // Cancelled or timed out.
+    Item_heuristic item_heuristic_{fewest_options}; // Item choice rule.
+    uint64_t nodes_until_check_{0};              // Countdown to next check.
     uint64_t num_items_{0};                      // What needs to be covered.
     uint64_t num_options_{0};                    // Available options.
     Coverage_type requested_cover_solution_{};   // ATTACK or DEFENSE
+    // What the trail search overwrote, oldest first, as whole entries.
+    std::vector<std::pair<uint64_t, Poke_link>> node_trail_{};
+    std::vector<std::pair<uint64_t, Type_name>> item_trail_{};
+    std::vector<std::pair<uint64_t, int32_t>> color_trail_{};
 
     /// @brief exact_dlx_recursive fills the output parameters with every exact
     /// cover that can be determined for defending against attack types or
@@ -249,13 +500,122 @@ class Pokemon_links {
                               Ranked_set<Type_encoding> &coverage,
                               int depth_limit);
 
+    /// @brief exact_stack_search is the explicit stack engine behind every
+    /// exact cover request that does not recurse. Each cover found is handed
+    /// to the visitor and the search continues while the visitor returns true.
+    /// If the visitor asks us to stop, the links are restored before return.
+    /// @param choice_limit size of a pokemon team or the number of attacks a
+    /// team can have.
+    /// @param visit called with every cover found. Return false to stop.
+    template <class Visitor>
+    void exact_stack_search(int choice_limit, Visitor &&visit);
+
+    /// @brief overlapping_stack_search the overlapping cover counterpart to
+    /// exact_stack_search. The visitor may see the same cover more than once
+    /// because overlapping covers can be reached in many orders.
+    /// @param choice_limit size of a pokemon team or the number of attacks a
+    /// team can have.
+    /// @param visit called with every cover found. Return false to stop.
+    template <class Visitor>
+    void overlapping_stack_search(int choice_limit, Visitor &&visit);
+
+    /// @brief trail_stack_search is the explicit stack engine with a trail.
+    /// Every write to the links is logged with the entry it replaced, so
+    /// leaving a branch is one reverse loop over the log back to the mark the
+    /// branch began at instead of walking the option again. A stopped search
+    /// unwinds to the root mark the same way however deep it was.
+    /// @param choice_limit size of a pokemon team or the number of attacks a
+    /// team can have.
+    /// @param overlapping true for overlapping covers, false for exact.
+    /// @param visit called with every cover found. Return false to stop.
+    template <class Visitor>
+    void trail_stack_search(int choice_limit, bool overlapping,
+                            Visitor &&visit);
+
+    /// @brief overlapping_unique_search the overlapping stack search with
+    /// every cover reported once. The same cover is reached along many orders
+    /// of its options and only the order the stack search meets first is
+    /// reported, so the covers found here are those of the stack search with
+    /// the repeats removed.
+    /// @param choice_limit size of a pokemon team or the number of attacks a
+    /// team can have.
+    /// @param visit called with every cover found. Return false to stop.
+    template <class Visitor>
+    void overlapping_unique_search(int choice_limit, Visitor &&visit);
+
+    /// @brief first_order checks that a cover just found was reached along
+    /// the first order of its options the stack search meets. An option of
+    /// the cover higher in the column of a branching item than the option
+    /// taken was tried there first, and if the rest of the cover can still be
+    /// taken after it the cover was already reported along that order.
+    /// @param dfs the search path to the cover. It is covered again on return.
+    /// @param choice_limit the choices left once the cover was found.
+    /// @return true if no earlier order reaches the same cover.
+    [[nodiscard]] bool first_order(const std::vector<Branch> &dfs,
+                                   int choice_limit);
+
+    /// @brief completes_with runs the overlapping stack search over only the
+    /// given options and reports if every one of them is taken by the time
+    /// all items are covered.
+    /// @param rest a node of each option left to take. Its order may change.
+    /// @param depth_tag the tag for the next option covered.
+    /// @return true if some branch takes all of rest and covers every item.
+    [[nodiscard]] bool completes_with(std::vector<uint64_t> &rest,
+                                      int depth_tag);
+
+    /// @brief node_in_item finds the node an option has in an item's column
+    /// if that node is still linked into the column.
+    /// @param index_in_option any node of the option.
+    /// @param item the item whose column is searched.
+    /// @return the node or 0 if the option does not reach the item.
+    [[nodiscard]] uint64_t node_in_item(uint64_t index_in_option,
+                                        uint64_t item) const;
+
+    /// @brief trail_mark the current length of every trail.
+    [[nodiscard]] Trail_mark trail_mark() const;
+
+    /// @brief undo_trail restores every entry written since the mark, newest
+    /// first, and shortens the trails back to it.
+    void undo_trail(const Trail_mark &mark);
+
+    /// @brief trail_cover_type is cover_type with every write logged.
+    [[nodiscard]] Encoding_score trail_cover_type(uint64_t index_in_option);
+
+    /// @brief trail_hide_options is hide_options with every write logged.
+    void trail_hide_options(uint64_t index_in_option);
+
+    /// @brief trail_hide_row_except is hide_row_except with every write
+    /// logged.
+    void trail_hide_row_except(uint64_t index_in_option);
+
+    /// @brief trail_commit_secondary is commit_secondary with every write
+    /// logged.
+    void trail_commit_secondary(uint64_t index_in_option);
+
+    /// @brief trail_overlapping_cover_type is overlapping_cover_type with
+    /// every write logged.
+    [[nodiscard]] Encoding_score trail_overlapping_cover_type(Cover_tag tag);
+
+    /// @brief add_to_group places a cover in the group for its size. Every
+    /// group has its own output cap so small covers are never crowded out by
+    /// the much more numerous large covers.
+    /// @param groups the groups indexed by cover size.
+    /// @param full_groups the running count of groups that reached the cap.
+    /// @param coverage the cover to record.
+    /// @return true if the search should continue, false if every group is
+    /// full.
+    [[nodiscard]] bool
+    add_to_group(std::vector<std::set<Ranked_set<Type_encoding>>> &groups,
+                 uint64_t &full_groups,
+                 const Ranked_set<Type_encoding> &coverage);
+
     /// @brief overlapping_dlx_recursive fills the output parameter with every
     /// overlapping cover that can be determined for defending against attack
     /// types or attacking defensive types. Overlapping covers use any number of
     /// options within their depth limit to cover all items. Two options
-    /// covering some overlapping items is acceptable. This is slower and I have
-    /// no way to not generate duplicates other than using a set. Better ideas
-    /// wanted.
+    /// covering some overlapping items is acceptable. This is slower and the
+    /// same cover is reached in many orders so a set removes duplicates. See
+    /// overlapping_unique_search for a search that reports each cover once.
     /// @param coverages the output parameter as our final solution if found.
     /// @param coverage the helper set that fills the output parameter.
     /// @param depth_tag a tag used to signify the recursive depth. Internal.
@@ -264,6 +624,58 @@ class Pokemon_links {
                               Ranked_set<Type_encoding> &coverage,
                               int depth_tag);
 
+    /// @brief pareto_stack_search keeps an archive of the covers no other
+    /// cover beats on every objective. A branch is abandoned as soon as the
+    /// best objectives it could still reach are dominated by the archive.
+    /// Every objective only worsens as options are added and every item left
+    /// must add at least the weakest multiplier to the score, which is what
+    /// makes this bound safe.
+    /// @param choice_limit size of a pokemon team or the number of attacks a
+    /// team can have.
+    /// @param overlapping true for overlapping covers, false for exact.
+    /// @param objectives the objectives to trade off in the order reported.
+    /// @return the non-dominated covers sorted by their scores.
+    [[nodiscard]] std::vector<Pareto_cover>
+    pareto_stack_search(int choice_limit, bool overlapping,
+                        const std::vector<Objective> &objectives);
+
+    /// @brief species_cover turns the options on the search path into a cover
+    /// of option table indices so species that share a typing stay distinct.
+    /// @param path the branches of the search that hold the chosen options.
+    /// @return the cover with its rank.
+    [[nodiscard]] Ranked_set<uint64_t>
+    species_cover(const std::vector<Branch> &path) const;
+
+    /// @brief option_of finds which option a node belongs to.
+    /// @param index_in_option any node in the option.
+    /// @return the index of the option in the option table.
+    [[nodiscard]] uint64_t option_of(uint64_t index_in_option) const;
+
+    /// @brief choose_pareto_option adds an option to the objectives of the
+    /// partial cover.
+    /// @param state the objectives of the partial cover.
+    /// @param index_in_option any node in the option that was chosen.
+    /// @param score the score that covering the option earned.
+    void choose_pareto_option(Pareto_state &state, uint64_t index_in_option,
+                              int32_t score) const;
+
+    /// @brief unchoose_pareto_option takes an option back out.
+    /// @param state the objectives of the partial cover.
+    /// @param index_in_option any node in the option that was chosen.
+    /// @param score the score that covering the option earned.
+    void unchoose_pareto_option(Pareto_state &state, uint64_t index_in_option,
+                                int32_t score) const;
+
+    /// @brief begin_search resets the output limit and stop status before any
+    /// search begins.
+    void begin_search();
+
+    /// @brief should_stop is cheap to call at every node of a search. Only
+    /// every so many nodes does it ask the stop token and the clock whether
+    /// the search must end. Once a search stops it stays stopped.
+    /// @return true if the search must unwind now.
+    [[nodiscard]] bool should_stop();
+
     /// @brief choose_item choose an item to cover that appears the least across
     /// all options. If an item becomes inaccessible over the course of
     /// recursion I signify this by returning 0. That branch should fail at that
@@ -303,6 +715,33 @@ class Pokemon_links {
     /// given same index.
     void unhide_options(uint64_t index_in_option);
 
+    /// @brief hide_row_except removes every node of an option from its column
+    /// except the node we are given. This is one row of hide_options.
+    /// @param index_in_option the node that stays in its column.
+    void hide_row_except(uint64_t index_in_option);
+
+    /// @brief unhide_row_except undoes hide_row_except for the same node.
+    /// @param index_in_option the node that stayed in its column.
+    void unhide_row_except(uint64_t index_in_option);
+
+    /// @brief is_secondary secondary items are never chosen for covering and
+    /// live after all the primary items in the headers.
+    /// @param header_index the column header of a node.
+    /// @return true if the header belongs to a secondary item.
+    [[nodiscard]] bool is_secondary(uint64_t header_index) const;
+
+    /// @brief commit_secondary a chosen option claims a secondary item. An
+    /// uncolored node takes the item from every other option. A colored node
+    /// only takes it from options that disagree on the color and marks the
+    /// agreeing nodes as already settled. A settled node does nothing.
+    /// @param index_in_option the node of the chosen option in the secondary
+    /// item column.
+    void commit_secondary(uint64_t index_in_option);
+
+    /// @brief uncommit_secondary undoes the work of commit_secondary.
+    /// @param index_in_option the same node given to commit_secondary.
+    void uncommit_secondary(uint64_t index_in_option);
+
     /// @brief overlapping_cover_type  performs a loose or "overlapping" cover
     /// of items in a dancing links algorithm. We allow other options that cover
     /// items already covered to stay accessible in the links leading to many
@@ -325,17 +764,26 @@ class Pokemon_links {
     void overlapping_uncover_type(uint64_t index_in_option);
 
     /// @brief find_item_index  performs binary search on the sorted item array
-    /// to find its index in the links array as the column header.
+    /// to find its index in the links array as the column header. Links over
+    /// several generations hold one item per generation with the same name
+    /// next to each other and this finds the first of them.
     /// @param item the type item we search for depending on ATTACK or DEFENSE.
     /// @return the index in the item lookup table. This is same as header in
     /// links.
     [[nodiscard]] uint64_t find_item_index(Type_encoding item) const;
 
-    /// @brief find_item_index performs binary search on the sorted option array
-    /// to find its index in the links array as the row spacer.
-    /// @param item the type item we search for depending on ATTACK or DEFENSE.
-    /// @return the index in the item option table. This is same as spacer in
-    /// links.
+    /// @brief find_item_index finds the item of one generation in links built
+    /// over several generations.
+    /// @return the index in the item table or zero if it is not there.
+    [[nodiscard]] uint64_t find_item_index(Type_encoding item,
+                                           int generation) const;
+
+    /// @brief find_option_index performs binary search on the sorted option
+    /// array. Species links hold one option per distinct species row with the
+    /// rows of a typing next to each other and this finds the first of them.
+    /// @param option the type option we search for.
+    /// @return the index in the option table or zero if it is not there. The
+    /// option table entry holds the spacer of the row in the links.
     [[nodiscard]] uint64_t find_option_index(Type_encoding option) const;
 
     /// @brief hide_item hiding an item in the links means we simply tag its
@@ -365,6 +813,16 @@ class Pokemon_links {
     /// links array.
     void unhide_option(uint64_t row_index);
 
+    /// @brief hide_multiplier splices every node with the given multiplier out
+    /// of its item and tags it hidden so row traversals skip it.
+    /// @param multiplier the group of nodes that leaves the threshold.
+    void hide_multiplier(Multiplier multiplier);
+
+    /// @brief unhide_multiplier undoes hide_multiplier. Groups of nodes must
+    /// return in the reverse order they were hidden.
+    /// @param multiplier the group of nodes that enters the threshold.
+    void unhide_multiplier(Multiplier multiplier);
+
     ////////////////   Dancing Links Instantiation and Building
 
     /// @brief build_defense_links defensive links have all typings for a
@@ -373,9 +831,48 @@ class Pokemon_links {
     /// recursion and record the names of the items and options.
     /// @param type_interactions the map of interactions and resistances
     /// between types in a gen.
+    /// @param rules optional team rules that become secondary items.
     void build_defense_links(
+        const std::map<Type_encoding, std::set<Resistance>> &type_interactions,
+        const std::vector<Team_rule> &rules = {});
+
+    /// @brief build_defense_items places every attack type of the generation
+    /// in the item table and the headers of the links.
+    /// @param type_interactions the map of interactions and resistances
+    /// between types in a gen.
+    /// @return the column builder initialize_columns needs.
+    std::unordered_map<Type_encoding, uint64_t> build_defense_items(
         const std::map<Type_encoding, std::set<Resistance>> &type_interactions);
 
+    /// @brief build_species_links species links are defensive links with one
+    /// option per distinct species row. Every typing with more than one row
+    /// gets a secondary item so a cover holds at most one row per typing.
+    /// @param type_interactions the map of interactions and resistances
+    /// between types in a gen.
+    /// @param species the species that become options.
+    void build_species_links(
+        const std::map<Type_encoding, std::set<Resistance>> &type_interactions,
+        const std::vector<Species> &species);
+
+    /// @brief build_secondary_items turns team rules into secondary item
+    /// headers placed directly after the primary item headers.
+    /// @param type_interactions the map of interactions and resistances
+    /// between types in a gen.
+    /// @param rules the team rules to enforce during the search.
+    /// @return the secondary nodes every option needs in the order the
+    /// options appear in the map.
+    std::vector<std::vector<Secondary_node>> build_secondary_items(
+        const std::map<Type_encoding, std::set<Resistance>> &type_interactions,
+        const std::vector<Team_rule> &rules);
+
+    /// @brief build_combined_links builds links over several generations with
+    /// one item per generation for every attack type, or typing for attack
+    /// links, and the options every generation shares.
+    /// @param generations the interaction maps keyed by generation number.
+    void build_combined_links(
+        const std::map<int, std::map<Type_encoding, std::set<Resistance>>>
+            &generations);
+
     /// @brief build_attack_links attack links have all single attack types for
     /// a generation as options and all possible Pokemon typings as items in the
     /// links.
@@ -392,10 +889,14 @@ class Pokemon_links {
     /// columns.
     /// @param requested_coverage requested coverage to know which multipliers
     /// to pay attention to.
+    /// @param secondary_rows the secondary nodes of every option in map order.
+    /// Leave empty if there are no secondary items.
+    template <class Rows>
     void initialize_columns(
-        const std::map<Type_encoding, std::set<Resistance>> &type_interactions,
+        const Rows &type_interactions,
         std::unordered_map<Type_encoding, uint64_t> &column_builder,
-        Coverage_type requested_coverage);
+        Coverage_type requested_coverage,
+        const std::vector<std::vector<Secondary_node>> &secondary_rows = {});
 
 }; // class Pokemon_links
 
@@ -425,6 +926,126 @@ overlapping_cover_stack(Pokemon_links &dlx, int choice_limit)
     return dlx.overlapping_coverages_stack(choice_limit);
 }
 
+std::set<Ranked_set<Type_encoding>>
+exact_cover_trail(Pokemon_links &dlx, int choice_limit)
+{
+    return dlx.exact_coverages_trail(choice_limit);
+}
+
+std::set<Ranked_set<Type_encoding>>
+overlapping_cover_trail(Pokemon_links &dlx, int choice_limit)
+{
+    return dlx.overlapping_coverages_trail(choice_limit);
+}
+
+std::vector<Ranked_set<Type_encoding>>
+overlapping_cover_unique(Pokemon_links &dlx, int choice_limit)
+{
+    return dlx.overlapping_coverages_unique(choice_limit);
+}
+
+std::vector<std::set<Ranked_set<Type_encoding>>>
+exact_cover_grouped(Pokemon_links &dlx, int choice_limit)
+{
+    return dlx.exact_coverages_grouped(choice_limit);
+}
+
+std::vector<std::set<Ranked_set<Type_encoding>>>
+overlapping_cover_grouped(Pokemon_links &dlx, int choice_limit)
+{
+    return dlx.overlapping_coverages_grouped(choice_limit);
+}
+
+std::vector<uint64_t>
+exact_cover_counts(Pokemon_links &dlx, int choice_limit)
+{
+    return dlx.exact_coverage_counts(choice_limit);
+}
+
+uint64_t
+exact_cover_streamed(
+    Pokemon_links &dlx, int choice_limit,
+    const std::function<bool(const Ranked_set<Type_encoding> &)> &visit)
+{
+    return dlx.exact_coverages_streamed(choice_limit, visit);
+}
+
+uint64_t
+overlapping_cover_streamed(
+    Pokemon_links &dlx, int choice_limit,
+    const std::function<bool(const Ranked_set<Type_encoding> &)> &visit)
+{
+    return dlx.overlapping_coverages_streamed(choice_limit, visit);
+}
+
+std::vector<Pokemon_links::Pareto_cover>
+exact_pareto_cover(Pokemon_links &dlx, int choice_limit,
+                   const std::vector<Pokemon_links::Objective> &objectives)
+{
+    return dlx.exact_pareto_coverages(choice_limit, objectives);
+}
+
+std::vector<Pokemon_links::Pareto_cover>
+overlapping_pareto_cover(
+    Pokemon_links &dlx, int choice_limit,
+    const std::vector<Pokemon_links::Objective> &objectives)
+{
+    return dlx.overlapping_pareto_coverages(choice_limit, objectives);
+}
+
+std::set<Ranked_set<uint64_t>>
+exact_species_cover(Pokemon_links &dlx, int choice_limit)
+{
+    return dlx.exact_species_coverages(choice_limit);
+}
+
+std::set<Ranked_set<uint64_t>>
+overlapping_species_cover(Pokemon_links &dlx, int choice_limit)
+{
+    return dlx.overlapping_species_coverages(choice_limit);
+}
+
+const std::vector<std::string> &
+option_species(const Pokemon_links &dlx, uint64_t option)
+{
+    return dlx.get_option_species(option);
+}
+
+/// Every species team a cover stands for, one at a time, without building the
+/// whole product of the species lists.
+uint64_t
+for_each_species_team(
+    const Pokemon_links &dlx, const Ranked_set<uint64_t> &cover,
+    const std::function<bool(const std::vector<std::string_view> &)> &visit)
+{
+    std::vector<uint64_t> choice(cover.size(), 0);
+    std::vector<std::string_view> team(cover.size());
+    const std::vector<uint64_t> options(cover.begin(), cover.end());
+    uint64_t teams = 0;
+    for (;;)
+    {
+        for (uint64_t i = 0; i < options.size(); ++i)
+        {
+            team[i] = dlx.get_option_species(options[i])[choice[i]];
+        }
+        ++teams;
+        if (!visit(team))
+        {
+            return teams;
+        }
+        uint64_t i = 0;
+        while (i < options.size()
+               && ++choice[i] == dlx.get_option_species(options[i]).size())
+        {
+            choice[i++] = 0;
+        }
+        if (i == options.size())
+        {
+            return teams;
+        }
+    }
+}
+
 bool
 has_max_solutions(const Pokemon_links &dlx)
 {
@@ -498,6 +1119,12 @@ hide_items_except(Pokemon_links &dlx, const std::set<Type_encoding> &to_keep)
     dlx.hide_all_items_except(to_keep);
 }
 
+bool
+set_live_items(Pokemon_links &dlx, const std::vector<bool> &live)
+{
+    return dlx.set_live_items(live);
+}
+
 uint64_t
 num_hid_items(const Pokemon_links &dlx)
 {
@@ -559,6 +1186,12 @@ hide_options_except(Pokemon_links &dlx, const std::set<Type_encoding> &to_keep)
     dlx.hide_all_options_except(to_keep);
 }
 
+bool
+set_live_options(Pokemon_links &dlx, const std::vector<bool> &live)
+{
+    return dlx.set_live_options(live);
+}
+
 uint64_t
 num_hid_options(const Pokemon_links &dlx)
 {
@@ -601,6 +1234,60 @@ reset_all(Pokemon_links &dlx)
     dlx.reset_items_options();
 }
 
+bool
+set_threshold(Pokemon_links &dlx, Multiplier threshold)
+{
+    return dlx.set_threshold(threshold);
+}
+
+Multiplier
+threshold(const Pokemon_links &dlx)
+{
+    return dlx.get_threshold();
+}
+
+void
+set_stop_token(Pokemon_links &dlx, std::stop_token token)
+{
+    dlx.set_stop_token(std::move(token));
+}
+
+void
+set_deadline(Pokemon_links &dlx, std::chrono::steady_clock::time_point deadline)
+{
+    dlx.set_deadline(deadline);
+}
+
+void
+clear_stop_conditions(Pokemon_links &dlx)
+{
+    dlx.clear_stop_conditions();
+}
+
+Pokemon_links::Search_status
+search_status(const Pokemon_links &dlx)
+{
+    return dlx.get_search_status();
+}
+
+void
+set_output_limit(Pokemon_links &dlx, std::size_t limit)
+{
+    dlx.set_output_limit(limit);
+}
+
+void
+set_item_heuristic(Pokemon_links &dlx, Pokemon_links::Item_heuristic heuristic)
+{
+    dlx.set_item_heuristic(heuristic);
+}
+
+void
+set_column_order(Pokemon_links &dlx, Pokemon_links::Column_order order)
+{
+    dlx.set_column_order(order);
+}
+
 } // namespace Dancing_links
 
 ////////////////////////////////////////   Implementation
@@ -609,15 +1296,38 @@ namespace Dancing_links {
 
 /////////////////////////    Algorithm X via Dancing Links
 
-std::set<Ranked_set<Type_encoding>>
-Pokemon_links::exact_coverages_stack(int choice_limit)
+namespace {
+
+/// Most visitors only want the cover. Those that also take the search path
+/// can see exactly which options were chosen.
+template <class Visitor, class Path>
+bool
+report(Visitor &visit, const Ranked_set<Type_encoding> &coverage,
+       const Path &path)
 {
-    hit_limit_ = false;
+    if constexpr (std::is_invocable_v<Visitor &,
+                                      const Ranked_set<Type_encoding> &,
+                                      const Path &>)
+    {
+        return visit(coverage, path);
+    }
+    else
+    {
+        return visit(coverage);
+    }
+}
+
+} // namespace
+
+template <class Visitor>
+void
+Pokemon_links::exact_stack_search(int choice_limit, Visitor &&visit)
+{
+    begin_search();
     if (choice_limit <= 0)
     {
-        return {};
+        return;
     }
-    std::set<Ranked_set<Type_encoding>> coverages = {};
     Ranked_set<Type_encoding> coverage{};
     coverage.reserve(choice_limit);
     const uint64_t start = choose_item();
@@ -652,19 +1362,18 @@ Pokemon_links::exact_coverages_stack(int choice_limit)
             coverage.insert(cur.score.value().score, cur.score.value().name));
         --choice_limit;
 
-        if (item_table_[0].right == 0 && choice_limit >= 0)
+        const bool solved = item_table_[0].right == 0 && choice_limit >= 0;
+        if ((solved && !report(visit, coverage, dfs)) || should_stop())
         {
-            coverages.insert(coverage);
-            if (coverages.size() != max_output_)
-            {
-                continue;
-            }
-            hit_limit_ = true;
             for (size_t i = dfs.size() - 1; i != static_cast<size_t>(-1); --i)
             {
                 uncover_type(dfs[i].option);
             }
-            return coverages;
+            return;
+        }
+        if (solved)
+        {
+            continue;
         }
 
         const uint64_t next_to_cover = choose_item();
@@ -677,35 +1386,125 @@ Pokemon_links::exact_coverages_stack(int choice_limit)
         dfs.emplace_back(next_to_cover, next_to_cover,
                          std::optional<Encoding_score>{});
     }
-    return coverages;
 }
 
 std::set<Ranked_set<Type_encoding>>
-Pokemon_links::exact_coverages_functional(int choice_limit)
+Pokemon_links::exact_coverages_stack(int choice_limit)
 {
     std::set<Ranked_set<Type_encoding>> coverages = {};
-    Ranked_set<Type_encoding> coverage{};
-    hit_limit_ = false;
-    exact_dlx_functional(coverages, coverage, choice_limit);
+    exact_stack_search(choice_limit,
+                       [this, &coverages](
+                           const Ranked_set<Type_encoding> &coverage) {
+                           coverages.insert(coverage);
+                           if (coverages.size() != max_output_)
+                           {
+                               return true;
+                           }
+                           hit_limit_ = true;
+                           return false;
+                       });
     return coverages;
 }
 
-void
-Pokemon_links::exact_dlx_functional( // NOLINT
-    std::set<Ranked_set<Type_encoding>> &coverages,
-    Ranked_set<Type_encoding> &coverage, int depth_limit)
+std::vector<std::set<Ranked_set<Type_encoding>>>
+Pokemon_links::exact_coverages_grouped(int choice_limit)
 {
-    if (item_table_[0].right == 0 && depth_limit >= 0)
-    {
-        coverages.insert(coverage);
-        return;
-    }
-    // Depth limit is either the size of a Pokemon Team or the number of attack
-    // slots on a team.
-    if (depth_limit <= 0)
-    {
-        return;
-    }
+    // Index zero stays empty. A cover of size N is found at index N.
+    std::vector<std::set<Ranked_set<Type_encoding>>> groups(
+        std::max(choice_limit, 0) + 1);
+    uint64_t full_groups = 0;
+    exact_stack_search(
+        choice_limit,
+        [this, &groups, &full_groups](
+            const Ranked_set<Type_encoding> &coverage) {
+            return add_to_group(groups, full_groups, coverage);
+        });
+    return groups;
+}
+
+std::vector<uint64_t>
+Pokemon_links::exact_coverage_counts(int choice_limit)
+{
+    // Exact covers are never found twice so there is no need to store them in
+    // a set to count them. There is no output cap when we only count.
+    std::vector<uint64_t> counts(std::max(choice_limit, 0) + 1, 0);
+    exact_stack_search(choice_limit,
+                       [&counts](const Ranked_set<Type_encoding> &coverage) {
+                           ++counts[coverage.size()];
+                           return true;
+                       });
+    return counts;
+}
+
+/// Streaming hands covers out as the links find them so a caller can start
+/// working before the search ends. The output cap still applies.
+
+uint64_t
+Pokemon_links::exact_coverages_streamed(
+    int choice_limit,
+    const std::function<bool(const Ranked_set<Type_encoding> &)> &visit)
+{
+    uint64_t found = 0;
+    exact_stack_search(choice_limit,
+                       [this, &found, &visit](
+                           const Ranked_set<Type_encoding> &coverage) {
+                           ++found;
+                           if (found == max_output_)
+                           {
+                               hit_limit_ = true;
+                               static_cast<void>(visit(coverage));
+                               return false;
+                           }
+                           return visit(coverage);
+                       });
+    return found;
+}
+
+bool
+Pokemon_links::add_to_group(
+    std::vector<std::set<Ranked_set<Type_encoding>>> &groups,
+    uint64_t &full_groups, const Ranked_set<Type_encoding> &coverage)
+{
+    std::set<Ranked_set<Type_encoding>> &group = groups[coverage.size()];
+    if (group.size() == max_output_)
+    {
+        return true;
+    }
+    if (group.insert(coverage).second && group.size() == max_output_)
+    {
+        hit_limit_ = true;
+        ++full_groups;
+    }
+    // Group zero can never be filled so we are done when all others are.
+    return full_groups != groups.size() - 1;
+}
+
+std::set<Ranked_set<Type_encoding>>
+Pokemon_links::exact_coverages_functional(int choice_limit)
+{
+    std::set<Ranked_set<Type_encoding>> coverages = {};
+    Ranked_set<Type_encoding> coverage{};
+    begin_search();
+    exact_dlx_functional(coverages, coverage, choice_limit);
+    return coverages;
+}
+
+void
+Pokemon_links::exact_dlx_functional( // NOLINT
+    std::set<Ranked_set<Type_encoding>> &coverages,
+    Ranked_set<Type_encoding> &coverage, int depth_limit)
+{
+    if (item_table_[0].right == 0 && depth_limit >= 0)
+    {
+        coverages.insert(coverage);
+        return;
+    }
+    // Depth limit is either the size of a Pokemon Team or the number of attack
+    // slots on a team.
+    if (depth_limit <= 0 || should_stop())
+    {
+        return;
+    }
     const uint64_t item_to_cover = choose_item();
     // An item has become inaccessible due to our chosen options so far, undo.
     if (!item_to_cover)
@@ -724,9 +1523,9 @@ Pokemon_links::exact_dlx_functional( // NOLINT
         // It is possible for these algorithms to produce many many sets. To
         // make the Pokemon Planner GUI more usable I cut off recursion if we
         // are generating too many sets.
-        if (coverages.size() == max_output_)
+        if (coverages.size() == max_output_ || stop_reason_ != complete)
         {
-            hit_limit_ = true;
+            hit_limit_ = coverages.size() == max_output_;
             uncover_type(cur);
             return;
         }
@@ -754,7 +1553,17 @@ Pokemon_links::cover_type(uint64_t index_in_option)
                 = option_table_[std::abs(links_[i - 1].top_or_len)].name;
             continue;
         }
-        if (!links_[top].tag)
+        // Nodes outside of the threshold have already left their items.
+        if (links_[i].tag == hidden || links_[top].tag)
+        {
+            row_lap = ++i == index_in_option;
+            continue;
+        }
+        if (is_secondary(top))
+        {
+            commit_secondary(i);
+        }
+        else
         {
             const Type_name cur = item_table_[top];
             item_table_[cur.left].right = cur.right;
@@ -789,7 +1598,16 @@ Pokemon_links::uncover_type(uint64_t index_in_option)
             row_lap = (i = links_[i].down) == index_in_option;
             continue;
         }
-        if (!links_[top].tag)
+        if (links_[i].tag == hidden || links_[top].tag)
+        {
+            row_lap = --i == index_in_option;
+            continue;
+        }
+        if (is_secondary(top))
+        {
+            uncommit_secondary(i);
+        }
+        else
         {
             const Type_name cur = item_table_[top];
             item_table_[cur.left].right = top;
@@ -816,24 +1634,7 @@ Pokemon_links::hide_options(uint64_t index_in_option)
         {
             continue;
         }
-        for (uint64_t col = row + 1; col != row;)
-        {
-            const int top = links_[col].top_or_len;
-            if (top <= 0)
-            {
-                col = links_[col].up;
-                continue;
-            }
-            // Some items may be hidden at any point by the user.
-            if (!links_[top].tag)
-            {
-                const Poke_link cur = links_[col];
-                links_[cur.up].down = cur.down;
-                links_[cur.down].up = cur.up;
-                --links_[top].top_or_len;
-            }
-            ++col;
-        }
+        hide_row_except(row);
     }
 }
 
@@ -847,109 +1648,1052 @@ Pokemon_links::unhide_options(uint64_t index_in_option)
         {
             continue;
         }
-        for (uint64_t col = row - 1; col != row;)
+        unhide_row_except(row);
+    }
+}
+
+void
+Pokemon_links::hide_row_except(uint64_t index_in_option)
+{
+    for (uint64_t col = index_in_option + 1; col != index_in_option;)
+    {
+        const int top = links_[col].top_or_len;
+        if (top <= 0)
+        {
+            col = links_[col].up;
+            continue;
+        }
+        // Some items may be hidden at any point by the user.
+        if (!links_[top].tag && links_[col].tag != hidden)
         {
-            const int top = links_[col].top_or_len;
-            if (top <= 0)
-            {
-                col = links_[col].down;
-                continue;
-            }
-            // Some items may be hidden at any point by the user.
-            if (!links_[top].tag)
-            {
-                const Poke_link cur = links_[col];
-                links_[cur.up].down = col;
-                links_[cur.down].up = col;
-                ++links_[top].top_or_len;
-            }
-            --col;
+            const Poke_link cur = links_[col];
+            links_[cur.up].down = cur.down;
+            links_[cur.down].up = cur.up;
+            --links_[top].top_or_len;
         }
+        ++col;
     }
 }
 
-//////////////////////  Shared Choosing Heuristic for Both Techniques
+void
+Pokemon_links::unhide_row_except(uint64_t index_in_option)
+{
+    for (uint64_t col = index_in_option - 1; col != index_in_option;)
+    {
+        const int top = links_[col].top_or_len;
+        if (top <= 0)
+        {
+            col = links_[col].down;
+            continue;
+        }
+        // Some items may be hidden at any point by the user.
+        if (!links_[top].tag && links_[col].tag != hidden)
+        {
+            const Poke_link cur = links_[col];
+            links_[cur.up].down = col;
+            links_[cur.down].up = col;
+            ++links_[top].top_or_len;
+        }
+        --col;
+    }
+}
 
-uint64_t
-Pokemon_links::choose_item() const
+/// Secondary items follow Knuth's exact cover with colors. An uncolored
+/// secondary item is covered like any other item but is never chosen to be
+/// covered. A colored item is purified instead. Options that disagree with
+/// the chosen color leave the links and the other agreeing nodes are marked
+/// settled so that choosing their options later does no work. The node that
+/// purified the column keeps its color so we know who must undo the work.
+
+bool
+Pokemon_links::is_secondary(uint64_t header_index) const
 {
-    int32_t min = INT32_MAX;
-    uint64_t chosen_index = 0;
-    for (uint64_t cur = item_table_[0].right; cur != 0;
-         cur = item_table_[cur].right)
+    return header_index >= secondary_start_;
+}
+
+void
+Pokemon_links::commit_secondary(uint64_t index_in_option)
+{
+    const int32_t color = colors_[index_in_option];
+    if (!color)
     {
-        // No way to reach this item. Bad past choices or impossible to solve.
-        if (links_[cur].top_or_len <= 0)
+        hide_options(index_in_option);
+        return;
+    }
+    if (color < 0)
+    {
+        return;
+    }
+    const auto header
+        = static_cast<uint64_t>(links_[index_in_option].top_or_len);
+    for (uint64_t row = links_[header].down; row != header;
+         row = links_[row].down)
+    {
+        if (row == index_in_option)
         {
-            return 0;
+            continue;
         }
-        if (links_[cur].top_or_len < min)
+        if (colors_[row] == color)
         {
-            chosen_index = cur;
-            min = links_[cur].top_or_len;
+            colors_[row] = -1;
+        }
+        else
+        {
+            hide_row_except(row);
         }
     }
-    return chosen_index;
 }
 
-///////////////////////   Overlapping Coverage via Dancing Links
+void
+Pokemon_links::uncommit_secondary(uint64_t index_in_option)
+{
+    const int32_t color = colors_[index_in_option];
+    if (!color)
+    {
+        unhide_options(index_in_option);
+        return;
+    }
+    if (color < 0)
+    {
+        return;
+    }
+    const auto header
+        = static_cast<uint64_t>(links_[index_in_option].top_or_len);
+    for (uint64_t row = links_[header].up; row != header; row = links_[row].up)
+    {
+        if (row == index_in_option)
+        {
+            continue;
+        }
+        if (colors_[row] < 0)
+        {
+            colors_[row] = color;
+        }
+        else
+        {
+            unhide_row_except(row);
+        }
+    }
+}
 
-std::set<Ranked_set<Type_encoding>>
-Pokemon_links::overlapping_coverages_stack(int choice_limit)
+/// Rows of one typing share a name so species covers are reported by their
+/// place in the option table instead. The search path has them already.
+
+std::set<Ranked_set<uint64_t>>
+Pokemon_links::exact_species_coverages(int choice_limit)
 {
-    hit_limit_ = false;
-    if (choice_limit <= 0)
+    std::set<Ranked_set<uint64_t>> coverages = {};
+    exact_stack_search(choice_limit,
+                       [this, &coverages](const Ranked_set<Type_encoding> &,
+                                          const std::vector<Branch> &path) {
+                           coverages.insert(species_cover(path));
+                           if (coverages.size() != max_output_)
+                           {
+                               return true;
+                           }
+                           hit_limit_ = true;
+                           return false;
+                       });
+    return coverages;
+}
+
+std::set<Ranked_set<uint64_t>>
+Pokemon_links::overlapping_species_coverages(int choice_limit)
+{
+    std::set<Ranked_set<uint64_t>> coverages = {};
+    overlapping_stack_search(
+        choice_limit, [this, &coverages](const Ranked_set<Type_encoding> &,
+                                         const std::vector<Branch> &path) {
+            coverages.insert(species_cover(path));
+            if (coverages.size() != max_output_)
+            {
+                return true;
+            }
+            hit_limit_ = true;
+            return false;
+        });
+    return coverages;
+}
+
+Ranked_set<uint64_t>
+Pokemon_links::species_cover(const std::vector<Branch> &path) const
+{
+    Ranked_set<uint64_t> cover{};
+    cover.reserve(path.size());
+    for (const Branch &b : path)
     {
-        return {};
+        static_cast<void>(cover.insert(b.score->score, option_of(b.option)));
     }
-    std::set<Ranked_set<Type_encoding>> coverages = {};
+    return cover;
+}
+
+uint64_t
+Pokemon_links::option_of(uint64_t index_in_option) const
+{
+    while (links_[index_in_option].top_or_len > 0)
+    {
+        --index_in_option;
+    }
+    return std::abs(links_[index_in_option].top_or_len);
+}
+
+const std::vector<std::string> &
+Pokemon_links::get_option_species(uint64_t option) const
+{
+    return option_species_.at(option);
+}
+
+/// A Pareto search shares the explicit stack of the other searches but
+/// carries the objectives of the partial cover along with it. Scores are
+/// compared with every objective turned into one to minimize.
+
+std::vector<Pokemon_links::Pareto_cover>
+Pokemon_links::exact_pareto_coverages(int choice_limit,
+                                      const std::vector<Objective> &objectives)
+{
+    return pareto_stack_search(choice_limit, false, objectives);
+}
+
+std::vector<Pokemon_links::Pareto_cover>
+Pokemon_links::overlapping_pareto_coverages(
+    int choice_limit, const std::vector<Objective> &objectives)
+{
+    return pareto_stack_search(choice_limit, true, objectives);
+}
+
+namespace {
+
+/// True if a is no worse than b everywhere and better somewhere.
+bool
+dominates(const std::vector<int> &a, const std::vector<int> &b)
+{
+    bool better = false;
+    for (uint64_t i = 0; i < a.size(); ++i)
+    {
+        if (b[i] < a[i])
+        {
+            return false;
+        }
+        better = better || a[i] < b[i];
+    }
+    return better;
+}
+
+} // namespace
+
+std::vector<Pokemon_links::Pareto_cover>
+Pokemon_links::pareto_stack_search(int choice_limit, bool overlapping,
+                                   const std::vector<Objective> &objectives)
+{
+    begin_search();
+    std::vector<Pareto_cover> archive{};
+    // Minimized copies of the archive scores so the hot loop never flips a
+    // sign.
+    std::vector<std::vector<int>> archive_keys{};
+    if (choice_limit <= 0 || objectives.empty())
+    {
+        return archive;
+    }
+    const int sign = requested_cover_solution_ == defense ? 1 : -1;
+    // The cheapest an uncovered item can be for the score objective.
+    const int32_t per_item = requested_cover_solution_ == defense ? imm : qdr;
+    Pareto_state state{0, 0, 0, 0, std::vector<uint8_t>(secondary_start_, 0)};
+    std::vector<int> key(objectives.size());
+    const auto fill_key = [&](int32_t size_bound, int32_t score_bound) {
+        for (uint64_t i = 0; i < objectives.size(); ++i)
+        {
+            switch (objectives[i])
+            {
+            case team_size:
+                key[i] = size_bound;
+                break;
+            case total_score:
+                key[i] = sign * score_bound;
+                break;
+            case shared_weaknesses:
+                key[i] = state.shared;
+                break;
+            case quad_weaknesses:
+                key[i] = state.quads;
+                break;
+            }
+        }
+    };
+    const auto dominated = [&]() {
+        return std::ranges::any_of(archive_keys, [&key](const auto &k) {
+            return dominates(k, key);
+        });
+    };
+
     Ranked_set<Type_encoding> coverage{};
     coverage.reserve(choice_limit);
     const uint64_t start = choose_item();
-    // A true recursive stack. We will only have O(depth) branches on the stack
-    // equivalent to current search path.
     std::vector<Branch> dfs{{start, start, {}}};
     dfs.reserve(choice_limit);
     while (!dfs.empty())
     {
         Branch &cur = dfs.back();
-        // If we return down the stack to any state again, it is time to move on
-        // from this option. This also ensures that proper cleanup happens when
-        // we are done with the entire search space.
         if (cur.score)
         {
-            overlapping_uncover_type(cur.option);
+            overlapping ? overlapping_uncover_type(cur.option)
+                        : uncover_type(cur.option);
+            unchoose_pareto_option(state, cur.option, cur.score->score);
+            static_cast<void>(
+                coverage.erase(cur.score->score, cur.score->name));
+            ++choice_limit;
+        }
+        cur.option = links_[cur.option].down;
+        if (cur.option == cur.item)
+        {
+            dfs.pop_back();
+            continue;
+        }
+        cur.score = overlapping
+                        ? overlapping_cover_type({cur.option, choice_limit})
+                        : cover_type(cur.option);
+        choose_pareto_option(state, cur.option, cur.score->score);
+        static_cast<void>(coverage.insert(cur.score->score, cur.score->name));
+        --choice_limit;
+
+        if (should_stop())
+        {
+            for (size_t i = dfs.size() - 1; i != static_cast<size_t>(-1); --i)
+            {
+                overlapping ? overlapping_uncover_type(dfs[i].option)
+                            : uncover_type(dfs[i].option);
+            }
+            break;
+        }
+        if (item_table_[0].right == 0 && choice_limit >= 0)
+        {
+            fill_key(state.size, state.score);
+            if (dominated()
+                || std::ranges::any_of(archive, [&coverage](const auto &p) {
+                       return p.cover == coverage;
+                   }))
+            {
+                continue;
+            }
+            for (uint64_t i = archive.size(); i-- > 0;)
+            {
+                if (dominates(key, archive_keys[i]))
+                {
+                    archive.erase(archive.begin() + static_cast<int64_t>(i));
+                    archive_keys.erase(archive_keys.begin()
+                                       + static_cast<int64_t>(i));
+                }
+            }
+            archive.push_back({coverage, {}});
+            archive_keys.push_back(key);
+            continue;
+        }
+
+        const uint64_t next_to_cover = choose_item();
+        if (!next_to_cover || choice_limit <= 0)
+        {
+            continue;
+        }
+        int32_t remaining = 0;
+        for (uint64_t i = item_table_[0].right; i != 0;
+             i = item_table_[i].right)
+        {
+            ++remaining;
+        }
+        fill_key(state.size + 1, state.score + (remaining * per_item));
+        if (dominated())
+        {
+            continue;
+        }
+        dfs.emplace_back(next_to_cover, next_to_cover,
+                         std::optional<Encoding_score>{});
+    }
+
+    // Report the scores as they are rather than minimized.
+    for (uint64_t i = 0; i < archive.size(); ++i)
+    {
+        archive[i].scores = archive_keys[i];
+        for (uint64_t o = 0; o < objectives.size(); ++o)
+        {
+            if (objectives[o] == total_score)
+            {
+                archive[i].scores[o] *= sign;
+            }
+        }
+    }
+    std::ranges::sort(archive,
+                      [](const Pareto_cover &a, const Pareto_cover &b) {
+                          return a.scores != b.scores ? a.scores < b.scores
+                                                      : a.cover < b.cover;
+                      });
+    return archive;
+}
+
+void
+Pokemon_links::choose_pareto_option(Pareto_state &state,
+                                    uint64_t index_in_option,
+                                    int32_t score) const
+{
+    ++state.size;
+    state.score += score;
+    if (weaknesses_.empty())
+    {
+        return;
+    }
+    const Weakness_profile &w = weaknesses_[option_of(index_in_option)];
+    state.quads += w.quads;
+    for (uint64_t bits = w.weak, item = 1; bits; bits >>= 1, ++item)
+    {
+        // Only the attack types this query asks about count against us.
+        if ((bits & 1) && links_[item].tag != hidden
+            && ++state.weak_counts[item] == 2)
+        {
+            ++state.shared;
+        }
+    }
+}
+
+void
+Pokemon_links::unchoose_pareto_option(Pareto_state &state,
+                                      uint64_t index_in_option,
+                                      int32_t score) const
+{
+    --state.size;
+    state.score -= score;
+    if (weaknesses_.empty())
+    {
+        return;
+    }
+    const Weakness_profile &w = weaknesses_[option_of(index_in_option)];
+    state.quads -= w.quads;
+    for (uint64_t bits = w.weak, item = 1; bits; bits >>= 1, ++item)
+    {
+        if ((bits & 1) && links_[item].tag != hidden
+            && state.weak_counts[item]-- == 2)
+        {
+            --state.shared;
+        }
+    }
+}
+
+//////////////////////  Shared Choosing Heuristic for Both Techniques
+
+/// Asking the clock at every node would cost more than the node itself so the
+/// stop conditions are only examined once every stop_check_interval nodes.
+constexpr uint64_t stop_check_interval = 1024;
+
+void
+Pokemon_links::begin_search()
+{
+    hit_limit_ = false;
+    stop_reason_ = complete;
+    nodes_until_check_ = stop_check_interval;
+}
+
+bool
+Pokemon_links::should_stop()
+{
+    if (stop_reason_ != complete)
+    {
+        return true;
+    }
+    if (--nodes_until_check_)
+    {
+        return false;
+    }
+    nodes_until_check_ = stop_check_interval;
+    if (stop_token_.stop_requested())
+    {
+        stop_reason_ = cancelled;
+    }
+    else if (deadline_ && std::chrono::steady_clock::now() >= *deadline_)
+    {
+        stop_reason_ = timed_out;
+    }
+    return stop_reason_ != complete;
+}
+
+uint64_t
+Pokemon_links::choose_item() const
+{
+    int32_t min = INT32_MAX;
+    uint64_t chosen_index = 0;
+    for (uint64_t cur = item_table_[0].right; cur != 0;
+         cur = item_table_[cur].right)
+    {
+        const int32_t len = links_[cur].top_or_len;
+        // No way to reach this item. Bad past choices or impossible to solve.
+        if (len <= 0)
+        {
+            return 0;
+        }
+        switch (item_heuristic_)
+        {
+        case fewest_options:
+            if (len < min)
+            {
+                chosen_index = cur;
+                min = len;
+            }
+            break;
+        case fewest_options_last:
+            if (len <= min)
+            {
+                chosen_index = cur;
+                min = len;
+            }
+            break;
+        case first_item:
+            if (!chosen_index)
+            {
+                chosen_index = cur;
+            }
+            break;
+        }
+    }
+    return chosen_index;
+}
+
+///////////////////////   Overlapping Coverage via Dancing Links
+
+template <class Visitor>
+void
+Pokemon_links::overlapping_stack_search(int choice_limit, Visitor &&visit)
+{
+    begin_search();
+    if (choice_limit <= 0)
+    {
+        return;
+    }
+    Ranked_set<Type_encoding> coverage{};
+    coverage.reserve(choice_limit);
+    const uint64_t start = choose_item();
+    // A true recursive stack. We will only have O(depth) branches on the stack
+    // equivalent to current search path.
+    std::vector<Branch> dfs{{start, start, {}}};
+    dfs.reserve(choice_limit);
+    while (!dfs.empty())
+    {
+        Branch &cur = dfs.back();
+        // If we return down the stack to any state again, it is time to move on
+        // from this option. This also ensures that proper cleanup happens when
+        // we are done with the entire search space.
+        if (cur.score)
+        {
+            overlapping_uncover_type(cur.option);
+            static_cast<void>(coverage.erase(cur.score.value().score,
+                                             cur.score.value().name));
+            ++choice_limit;
+        }
+        // This is a caching mechanism so that if we return to this level of
+        // recursion we will know how many options we have tried already. See
+        // the for loop in the functional version if this is confusing.
+        cur.option = links_[cur.option].down;
+        if (cur.option == cur.item)
+        {
+            dfs.pop_back();
+            continue;
+        }
+        cur.score = overlapping_cover_type({cur.option, choice_limit});
+        static_cast<void>(
+            coverage.insert(cur.score.value().score, cur.score.value().name));
+        --choice_limit;
+
+        const bool solved = item_table_[0].right == 0 && choice_limit >= 0;
+        if ((solved && !report(visit, coverage, dfs)) || should_stop())
+        {
+            for (size_t i = dfs.size() - 1; i != static_cast<size_t>(-1); --i)
+            {
+                overlapping_uncover_type(dfs[i].option);
+            }
+            return;
+        }
+        if (solved)
+        {
+            continue;
+        }
+
+        const uint64_t next_to_cover = choose_item();
+        if (!next_to_cover || choice_limit <= 0)
+        {
+            continue;
+        }
+        // We will know we encountered this branch for the first time if it does
+        // not have a score.
+        dfs.emplace_back(next_to_cover, next_to_cover,
+                         std::optional<Encoding_score>{});
+    }
+}
+
+std::set<Ranked_set<Type_encoding>>
+Pokemon_links::overlapping_coverages_stack(int choice_limit)
+{
+    std::set<Ranked_set<Type_encoding>> coverages = {};
+    overlapping_stack_search(choice_limit,
+                             [this, &coverages](
+                                 const Ranked_set<Type_encoding> &coverage) {
+                                 coverages.insert(coverage);
+                                 if (coverages.size() != max_output_)
+                                 {
+                                     return true;
+                                 }
+                                 hit_limit_ = true;
+                                 return false;
+                             });
+    return coverages;
+}
+
+uint64_t
+Pokemon_links::overlapping_coverages_streamed(
+    int choice_limit,
+    const std::function<bool(const Ranked_set<Type_encoding> &)> &visit)
+{
+    // Overlapping covers can be reached in many orders. Only the first time
+    // we see a cover is it passed along.
+    std::set<Ranked_set<Type_encoding>> seen = {};
+    overlapping_stack_search(choice_limit,
+                             [this, &seen, &visit](
+                                 const Ranked_set<Type_encoding> &coverage) {
+                                 if (!seen.insert(coverage).second)
+                                 {
+                                     return true;
+                                 }
+                                 if (seen.size() == max_output_)
+                                 {
+                                     hit_limit_ = true;
+                                     static_cast<void>(visit(coverage));
+                                     return false;
+                                 }
+                                 return visit(coverage);
+                             });
+    return seen.size();
+}
+
+std::vector<std::set<Ranked_set<Type_encoding>>>
+Pokemon_links::overlapping_coverages_grouped(int choice_limit)
+{
+    // Index zero stays empty. A cover of size N is found at index N.
+    std::vector<std::set<Ranked_set<Type_encoding>>> groups(
+        std::max(choice_limit, 0) + 1);
+    uint64_t full_groups = 0;
+    overlapping_stack_search(
+        choice_limit,
+        [this, &groups, &full_groups](
+            const Ranked_set<Type_encoding> &coverage) {
+            return add_to_group(groups, full_groups, coverage);
+        });
+    return groups;
+}
+
+std::set<Ranked_set<Type_encoding>>
+Pokemon_links::overlapping_coverages_functional(int choice_limit)
+{
+    std::set<Ranked_set<Type_encoding>> coverages = {};
+    Ranked_set<Type_encoding> coverage = {};
+    begin_search();
+    overlapping_dlx_recursive(coverages, coverage, choice_limit);
+    return coverages;
+}
+
+void
+Pokemon_links::overlapping_dlx_recursive( // NOLINT
+    std::set<Ranked_set<Type_encoding>> &coverages,
+    Ranked_set<Type_encoding> &coverage, int depth_tag)
+{
+    if (item_table_[0].right == 0 && depth_tag >= 0)
+    {
+        coverages.insert(coverage);
+        return;
+    }
+    if (depth_tag <= 0 || should_stop())
+    {
+        return;
+    }
+    // In certain generations certain types have no weaknesses so we might
+    // return 0 here.
+    const uint64_t item_to_cover = choose_item();
+    if (!item_to_cover)
+    {
+        return;
+    }
+
+    for (uint64_t cur = links_[item_to_cover].down; cur != item_to_cover;
+         cur = links_[cur].down)
+    {
+        const Encoding_score score = overlapping_cover_type({cur, depth_tag});
+        static_cast<void>(coverage.insert(score.score, score.name));
+
+        overlapping_dlx_recursive(coverages, coverage,
+                                  static_cast<int>(depth_tag - 1));
+
+        // It is possible for these algorithms to produce many many sets. To
+        // make the Pokemon Planner GUI more usable I cut off recursion if we
+        // are generating too many sets.
+        if (coverages.size() == max_output_ || stop_reason_ != complete)
+        {
+            hit_limit_ = coverages.size() == max_output_;
+            overlapping_uncover_type(cur);
+            return;
+        }
+        static_cast<void>(coverage.erase(score.score, score.name));
+        overlapping_uncover_type(cur);
+    }
+}
+
+/// Overlapping cover is much simpler at the cost of generating a tremendous
+/// number of solutions. We only need to know which items and options are
+/// covered at which recursive levels because we are more relaxed about leaving
+/// options available after items in those options have been covered by other
+/// options.
+
+Pokemon_links::Encoding_score
+Pokemon_links::overlapping_cover_type(Pokemon_links::Cover_tag tag)
+{
+    uint64_t i = tag.index;
+    bool row_lap = false;
+    Encoding_score result = {};
+    while (!row_lap)
+    {
+        const int top = links_[i].top_or_len;
+        if (top <= 0)
+        {
+            row_lap = (i = links_[i].up) == tag.index;
+            result.name
+                = option_table_[std::abs(links_[i - 1].top_or_len)].name;
+            continue;
+        }
+        if (links_[i].tag == hidden)
+        {
+            row_lap = ++i == tag.index;
+            continue;
+        }
+        // Secondary items are never covered in the loose sense. Even here an
+        // option may only claim them if no other chosen option has.
+        if (is_secondary(top))
+        {
+            commit_secondary(i);
+            row_lap = ++i == tag.index;
+            continue;
+        }
+        if (!links_[top].tag)
+        {
+            links_[top].tag = tag.tag;
+            item_table_[item_table_[top].left].right = item_table_[top].right;
+            item_table_[item_table_[top].right].left = item_table_[top].left;
+            result.score += links_[i].multiplier;
+        }
+        if (links_[top].tag != hidden)
+        {
+            links_[i].tag = tag.tag;
+        }
+        row_lap = ++i == tag.index;
+    }
+    return result;
+}
+
+void
+Pokemon_links::overlapping_uncover_type(uint64_t index_in_option)
+{
+    uint64_t i = --index_in_option;
+    bool row_lap = false;
+    while (!row_lap)
+    {
+        const int top = links_[i].top_or_len;
+        if (top < 0)
+        {
+            row_lap = (i = links_[i].down) == index_in_option;
+            continue;
+        }
+        if (links_[i].tag == hidden)
+        {
+            row_lap = --i == index_in_option;
+            continue;
+        }
+        if (is_secondary(top))
+        {
+            uncommit_secondary(i);
+            row_lap = --i == index_in_option;
+            continue;
+        }
+        if (links_[top].tag == links_[i].tag)
+        {
+            links_[top].tag = 0;
+            item_table_[item_table_[top].left].right = top;
+            item_table_[item_table_[top].right].left = top;
+        }
+        if (links_[top].tag != hidden)
+        {
+            links_[i].tag = 0;
+        }
+        row_lap = --i == index_in_option;
+    }
+}
+
+/// Two orders of the same overlapping cover must split at some branch by
+/// taking different options of the cover for the same item. The stack search
+/// tries the options of a column from the top down, so of all the orders that
+/// reach a cover it meets the one taking the highest option it can at every
+/// branch first. Only that order is reported. Nothing is set aside while
+/// searching, so both searches branch alike and reach exactly the same covers.
+
+template <class Visitor>
+void
+Pokemon_links::overlapping_unique_search(int choice_limit, Visitor &&visit)
+{
+    begin_search();
+    if (choice_limit <= 0)
+    {
+        return;
+    }
+    Ranked_set<Type_encoding> coverage{};
+    coverage.reserve(choice_limit);
+    const uint64_t start = choose_item();
+    std::vector<Branch> dfs{{start, start, {}}};
+    dfs.reserve(choice_limit);
+    while (!dfs.empty())
+    {
+        Branch &cur = dfs.back();
+        if (cur.score)
+        {
+            overlapping_uncover_type(cur.option);
+            static_cast<void>(coverage.erase(cur.score.value().score,
+                                             cur.score.value().name));
+            ++choice_limit;
+        }
+        cur.option = links_[cur.option].down;
+        if (cur.option == cur.item)
+        {
+            dfs.pop_back();
+            continue;
+        }
+        cur.score = overlapping_cover_type({cur.option, choice_limit});
+        static_cast<void>(
+            coverage.insert(cur.score.value().score, cur.score.value().name));
+        --choice_limit;
+
+        const bool solved = item_table_[0].right == 0 && choice_limit >= 0;
+        if ((solved && first_order(dfs, choice_limit)
+             && !report(visit, coverage, dfs))
+            || should_stop())
+        {
+            for (size_t i = dfs.size() - 1; i != static_cast<size_t>(-1); --i)
+            {
+                overlapping_uncover_type(dfs[i].option);
+            }
+            return;
+        }
+        if (solved)
+        {
+            continue;
+        }
+
+        const uint64_t next_to_cover = choose_item();
+        if (!next_to_cover || choice_limit <= 0)
+        {
+            continue;
+        }
+        dfs.emplace_back(next_to_cover, next_to_cover,
+                         std::optional<Encoding_score>{});
+    }
+}
+
+bool
+Pokemon_links::first_order(const std::vector<Branch> &dfs, int choice_limit)
+{
+    const auto earlier_option = [this, &dfs](size_t branch) {
+        for (size_t later = branch + 1; later < dfs.size(); ++later)
+        {
+            const uint64_t node
+                = node_in_item(dfs[later].option, dfs[branch].item);
+            if (node && node < dfs[branch].option)
+            {
+                return true;
+            }
+        }
+        return false;
+    };
+    // Most covers have no option above the taken one at any branch and are
+    // confirmed without touching the links.
+    size_t branch = 0;
+    while (branch < dfs.size() && !earlier_option(branch))
+    {
+        ++branch;
+    }
+    if (branch == dfs.size())
+    {
+        return true;
+    }
+    for (size_t i = dfs.size() - 1; i != branch - 1; --i)
+    {
+        overlapping_uncover_type(dfs[i].option);
+    }
+    const int top_tag = choice_limit + static_cast<int>(dfs.size());
+    bool first = true;
+    std::vector<uint64_t> rest{};
+    for (; branch < dfs.size() && first; ++branch)
+    {
+        const int tag = top_tag - static_cast<int>(branch);
+        for (size_t later = branch + 1; later < dfs.size() && first; ++later)
+        {
+            const uint64_t node
+                = node_in_item(dfs[later].option, dfs[branch].item);
+            if (!node || node > dfs[branch].option)
+            {
+                continue;
+            }
+            rest.clear();
+            for (size_t i = branch; i < dfs.size(); ++i)
+            {
+                if (i != later)
+                {
+                    rest.push_back(dfs[i].option);
+                }
+            }
+            static_cast<void>(overlapping_cover_type({node, tag}));
+            first = !completes_with(rest, tag - 1);
+            overlapping_uncover_type(node);
+        }
+        static_cast<void>(overlapping_cover_type({dfs[branch].option, tag}));
+    }
+    for (; branch < dfs.size(); ++branch)
+    {
+        static_cast<void>(overlapping_cover_type(
+            {dfs[branch].option, top_tag - static_cast<int>(branch)}));
+    }
+    return first;
+}
+
+bool
+Pokemon_links::completes_with(std::vector<uint64_t> &rest, int depth_tag)
+{
+    if (item_table_[0].right == 0 || rest.empty())
+    {
+        return item_table_[0].right == 0 && rest.empty();
+    }
+    const uint64_t item = choose_item();
+    if (!item)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < rest.size(); ++i)
+    {
+        const uint64_t node = node_in_item(rest[i], item);
+        if (!node)
+        {
+            continue;
+        }
+        std::swap(rest[i], rest.back());
+        rest.pop_back();
+        static_cast<void>(overlapping_cover_type({node, depth_tag}));
+        const bool completes = completes_with(rest, depth_tag - 1);
+        overlapping_uncover_type(node);
+        rest.push_back(node);
+        std::swap(rest[i], rest.back());
+        if (completes)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t
+Pokemon_links::node_in_item(uint64_t index_in_option, uint64_t item) const
+{
+    while (links_[index_in_option].top_or_len > 0)
+    {
+        --index_in_option;
+    }
+    for (uint64_t i = index_in_option + 1; links_[i].top_or_len > 0; ++i)
+    {
+        if (static_cast<uint64_t>(links_[i].top_or_len) == item)
+        {
+            return links_[links_[i].up].down == i ? i : 0;
+        }
+    }
+    return 0;
+}
+
+std::vector<Ranked_set<Type_encoding>>
+Pokemon_links::overlapping_coverages_unique(int choice_limit)
+{
+    std::vector<Ranked_set<Type_encoding>> coverages = {};
+    overlapping_unique_search(choice_limit,
+                              [this, &coverages](
+                                  const Ranked_set<Type_encoding> &coverage) {
+                                  coverages.push_back(coverage);
+                                  if (coverages.size() != max_output_)
+                                  {
+                                      return true;
+                                  }
+                                  hit_limit_ = true;
+                                  return false;
+                              });
+    return coverages;
+}
+
+//////////////////////////////     Trail Engine
+
+/// The stack engines undo a branch by walking its option again and splicing
+/// every link back in reverse. The trail engine makes the same writes as the
+/// stack engines but first logs the entry each write replaces. Undoing is then
+/// a copy loop over the newest entries with no link chasing at all, and any
+/// earlier state of the search is one undo away.
+
+template <class Visitor>
+void
+Pokemon_links::trail_stack_search(int choice_limit, bool overlapping,
+                                  Visitor &&visit)
+{
+    begin_search();
+    if (choice_limit <= 0)
+    {
+        return;
+    }
+    node_trail_.clear();
+    item_trail_.clear();
+    color_trail_.clear();
+    Ranked_set<Type_encoding> coverage{};
+    coverage.reserve(choice_limit);
+    const uint64_t start = choose_item();
+    std::vector<Branch> dfs{{start, start, {}}};
+    dfs.reserve(choice_limit);
+    // Every option tried at a depth starts from the state at its mark.
+    std::vector<Trail_mark> marks{trail_mark()};
+    marks.reserve(choice_limit);
+    while (!dfs.empty())
+    {
+        Branch &cur = dfs.back();
+        if (cur.score)
+        {
+            undo_trail(marks.back());
             static_cast<void>(coverage.erase(cur.score.value().score,
                                              cur.score.value().name));
             ++choice_limit;
         }
-        // This is a caching mechanism so that if we return to this level of
-        // recursion we will know how many options we have tried already. See
-        // the for loop in the functional version if this is confusing.
         cur.option = links_[cur.option].down;
         if (cur.option == cur.item)
         {
             dfs.pop_back();
+            marks.pop_back();
             continue;
         }
-        cur.score = overlapping_cover_type({cur.option, choice_limit});
+        cur.score
+            = overlapping
+                  ? trail_overlapping_cover_type({cur.option, choice_limit})
+                  : trail_cover_type(cur.option);
         static_cast<void>(
             coverage.insert(cur.score.value().score, cur.score.value().name));
         --choice_limit;
 
-        if (item_table_[0].right == 0 && choice_limit >= 0)
+        const bool solved = item_table_[0].right == 0 && choice_limit >= 0;
+        if ((solved && !report(visit, coverage, dfs)) || should_stop())
         {
-            coverages.insert(coverage);
-            if (coverages.size() != max_output_)
-            {
-                continue;
-            }
-            hit_limit_ = true;
-            for (size_t i = dfs.size() - 1; i != static_cast<size_t>(-1); --i)
-            {
-                overlapping_uncover_type(dfs[i].option);
-            }
-            return coverages;
+            undo_trail(marks.front());
+            return;
+        }
+        if (solved)
+        {
+            continue;
         }
 
         const uint64_t next_to_cover = choose_item();
@@ -957,132 +2701,234 @@ Pokemon_links::overlapping_coverages_stack(int choice_limit)
         {
             continue;
         }
-        // We will know we encountered this branch for the first time if it does
-        // not have a score.
         dfs.emplace_back(next_to_cover, next_to_cover,
                          std::optional<Encoding_score>{});
+        marks.push_back(trail_mark());
     }
+}
+
+std::set<Ranked_set<Type_encoding>>
+Pokemon_links::exact_coverages_trail(int choice_limit)
+{
+    std::set<Ranked_set<Type_encoding>> coverages = {};
+    trail_stack_search(choice_limit, false,
+                       [this, &coverages](
+                           const Ranked_set<Type_encoding> &coverage) {
+                           coverages.insert(coverage);
+                           if (coverages.size() != max_output_)
+                           {
+                               return true;
+                           }
+                           hit_limit_ = true;
+                           return false;
+                       });
     return coverages;
 }
 
 std::set<Ranked_set<Type_encoding>>
-Pokemon_links::overlapping_coverages_functional(int choice_limit)
+Pokemon_links::overlapping_coverages_trail(int choice_limit)
 {
     std::set<Ranked_set<Type_encoding>> coverages = {};
-    Ranked_set<Type_encoding> coverage = {};
-    hit_limit_ = false;
-    overlapping_dlx_recursive(coverages, coverage, choice_limit);
+    trail_stack_search(choice_limit, true,
+                       [this, &coverages](
+                           const Ranked_set<Type_encoding> &coverage) {
+                           coverages.insert(coverage);
+                           if (coverages.size() != max_output_)
+                           {
+                               return true;
+                           }
+                           hit_limit_ = true;
+                           return false;
+                       });
     return coverages;
 }
 
+Pokemon_links::Trail_mark
+Pokemon_links::trail_mark() const
+{
+    return {node_trail_.size(), item_trail_.size(), color_trail_.size()};
+}
+
 void
-Pokemon_links::overlapping_dlx_recursive( // NOLINT
-    std::set<Ranked_set<Type_encoding>> &coverages,
-    Ranked_set<Type_encoding> &coverage, int depth_tag)
+Pokemon_links::undo_trail(const Trail_mark &mark)
 {
-    if (item_table_[0].right == 0 && depth_tag >= 0)
-    {
-        coverages.insert(coverage);
-        return;
-    }
-    if (depth_tag <= 0)
+    // The arrays never share entries so each trail unwinds on its own.
+    while (node_trail_.size() > mark.nodes)
     {
-        return;
+        links_[node_trail_.back().first] = node_trail_.back().second;
+        node_trail_.pop_back();
     }
-    // In certain generations certain types have no weaknesses so we might
-    // return 0 here.
-    const uint64_t item_to_cover = choose_item();
-    if (!item_to_cover)
+    while (item_trail_.size() > mark.items)
     {
-        return;
+        item_table_[item_trail_.back().first] = item_trail_.back().second;
+        item_trail_.pop_back();
     }
-
-    for (uint64_t cur = links_[item_to_cover].down; cur != item_to_cover;
-         cur = links_[cur].down)
+    while (color_trail_.size() > mark.colors)
     {
-        const Encoding_score score = overlapping_cover_type({cur, depth_tag});
-        static_cast<void>(coverage.insert(score.score, score.name));
-
-        overlapping_dlx_recursive(coverages, coverage,
-                                  static_cast<int>(depth_tag - 1));
-
-        // It is possible for these algorithms to produce many many sets. To
-        // make the Pokemon Planner GUI more usable I cut off recursion if we
-        // are generating too many sets.
-        if (coverages.size() == max_output_)
-        {
-            hit_limit_ = true;
-            overlapping_uncover_type(cur);
-            return;
-        }
-        static_cast<void>(coverage.erase(score.score, score.name));
-        overlapping_uncover_type(cur);
+        colors_[color_trail_.back().first] = color_trail_.back().second;
+        color_trail_.pop_back();
     }
 }
 
-/// Overlapping cover is much simpler at the cost of generating a tremendous
-/// number of solutions. We only need to know which items and options are
-/// covered at which recursive levels because we are more relaxed about leaving
-/// options available after items in those options have been covered by other
-/// options.
-
 Pokemon_links::Encoding_score
-Pokemon_links::overlapping_cover_type(Pokemon_links::Cover_tag tag)
+Pokemon_links::trail_cover_type(uint64_t index_in_option)
 {
-    uint64_t i = tag.index;
-    bool row_lap = false;
     Encoding_score result = {};
+    uint64_t i = index_in_option;
+    bool row_lap = false;
     while (!row_lap)
     {
         const int top = links_[i].top_or_len;
         if (top <= 0)
         {
-            row_lap = (i = links_[i].up) == tag.index;
+            row_lap = (i = links_[i].up) == index_in_option;
             result.name
                 = option_table_[std::abs(links_[i - 1].top_or_len)].name;
             continue;
         }
-        if (!links_[top].tag)
+        if (links_[i].tag == hidden || links_[top].tag)
         {
-            links_[top].tag = tag.tag;
-            item_table_[item_table_[top].left].right = item_table_[top].right;
-            item_table_[item_table_[top].right].left = item_table_[top].left;
-            result.score += links_[i].multiplier;
+            row_lap = ++i == index_in_option;
+            continue;
         }
-        if (links_[top].tag != hidden)
+        if (is_secondary(top))
         {
-            links_[i].tag = tag.tag;
+            trail_commit_secondary(i);
         }
-        row_lap = ++i == tag.index;
+        else
+        {
+            const Type_name cur = item_table_[top];
+            item_trail_.emplace_back(cur.left, item_table_[cur.left]);
+            item_table_[cur.left].right = cur.right;
+            item_trail_.emplace_back(cur.right, item_table_[cur.right]);
+            item_table_[cur.right].left = cur.left;
+            trail_hide_options(i);
+            result.score += links_[i].multiplier;
+        }
+        row_lap = ++i == index_in_option;
     }
     return result;
 }
 
 void
-Pokemon_links::overlapping_uncover_type(uint64_t index_in_option)
+Pokemon_links::trail_hide_options(uint64_t index_in_option)
 {
-    uint64_t i = --index_in_option;
+    for (uint64_t row = links_[index_in_option].down; row != index_in_option;
+         row = links_[row].down)
+    {
+        if (static_cast<int>(row) == links_[index_in_option].top_or_len)
+        {
+            continue;
+        }
+        trail_hide_row_except(row);
+    }
+}
+
+void
+Pokemon_links::trail_hide_row_except(uint64_t index_in_option)
+{
+    for (uint64_t col = index_in_option + 1; col != index_in_option;)
+    {
+        const int top = links_[col].top_or_len;
+        if (top <= 0)
+        {
+            col = links_[col].up;
+            continue;
+        }
+        if (!links_[top].tag && links_[col].tag != hidden)
+        {
+            const Poke_link cur = links_[col];
+            node_trail_.emplace_back(cur.up, links_[cur.up]);
+            links_[cur.up].down = cur.down;
+            node_trail_.emplace_back(cur.down, links_[cur.down]);
+            links_[cur.down].up = cur.up;
+            node_trail_.emplace_back(top, links_[top]);
+            --links_[top].top_or_len;
+        }
+        ++col;
+    }
+}
+
+void
+Pokemon_links::trail_commit_secondary(uint64_t index_in_option)
+{
+    const int32_t color = colors_[index_in_option];
+    if (!color)
+    {
+        trail_hide_options(index_in_option);
+        return;
+    }
+    if (color < 0)
+    {
+        return;
+    }
+    const auto header
+        = static_cast<uint64_t>(links_[index_in_option].top_or_len);
+    for (uint64_t row = links_[header].down; row != header;
+         row = links_[row].down)
+    {
+        if (row == index_in_option)
+        {
+            continue;
+        }
+        if (colors_[row] == color)
+        {
+            color_trail_.emplace_back(row, color);
+            colors_[row] = -1;
+        }
+        else
+        {
+            trail_hide_row_except(row);
+        }
+    }
+}
+
+Pokemon_links::Encoding_score
+Pokemon_links::trail_overlapping_cover_type(Pokemon_links::Cover_tag tag)
+{
+    uint64_t i = tag.index;
     bool row_lap = false;
+    Encoding_score result = {};
     while (!row_lap)
     {
         const int top = links_[i].top_or_len;
-        if (top < 0)
+        if (top <= 0)
         {
-            row_lap = (i = links_[i].down) == index_in_option;
+            row_lap = (i = links_[i].up) == tag.index;
+            result.name
+                = option_table_[std::abs(links_[i - 1].top_or_len)].name;
             continue;
         }
-        if (links_[top].tag == links_[i].tag)
+        if (links_[i].tag == hidden)
         {
-            links_[top].tag = 0;
-            item_table_[item_table_[top].left].right = top;
-            item_table_[item_table_[top].right].left = top;
+            row_lap = ++i == tag.index;
+            continue;
+        }
+        if (is_secondary(top))
+        {
+            trail_commit_secondary(i);
+            row_lap = ++i == tag.index;
+            continue;
+        }
+        if (!links_[top].tag)
+        {
+            node_trail_.emplace_back(top, links_[top]);
+            links_[top].tag = tag.tag;
+            const Type_name cur = item_table_[top];
+            item_trail_.emplace_back(cur.left, item_table_[cur.left]);
+            item_table_[cur.left].right = cur.right;
+            item_trail_.emplace_back(cur.right, item_table_[cur.right]);
+            item_table_[cur.right].left = cur.left;
+            result.score += links_[i].multiplier;
         }
         if (links_[top].tag != hidden)
         {
-            links_[i].tag = 0;
+            node_trail_.emplace_back(i, links_[i]);
+            links_[i].tag = tag.tag;
         }
-        row_lap = --i == index_in_option;
+        row_lap = ++i == tag.index;
     }
+    return result;
 }
 
 //////////////////////////////     Utility Functions
@@ -1099,18 +2945,135 @@ Pokemon_links::item_table() const
     return item_table_;
 }
 
+const std::vector<int> &
+Pokemon_links::item_generations() const
+{
+    return item_generations_;
+}
+
 const std::vector<Pokemon_links::Encoding_index> &
 Pokemon_links::option_table() const
 {
     return option_table_;
 }
 
+const std::vector<int32_t> &
+Pokemon_links::node_colors() const
+{
+    return colors_;
+}
+
 bool
 Pokemon_links::reached_output_limit() const
 {
     return hit_limit_;
 }
 
+void
+Pokemon_links::set_stop_token(std::stop_token token)
+{
+    stop_token_ = std::move(token);
+}
+
+void
+Pokemon_links::set_deadline(std::chrono::steady_clock::time_point deadline)
+{
+    deadline_ = deadline;
+}
+
+void
+Pokemon_links::clear_stop_conditions()
+{
+    stop_token_ = {};
+    deadline_.reset();
+}
+
+Pokemon_links::Search_status
+Pokemon_links::get_search_status() const
+{
+    if (stop_reason_ != complete)
+    {
+        return stop_reason_;
+    }
+    return hit_limit_ ? output_limit : complete;
+}
+
+void
+Pokemon_links::set_output_limit(std::size_t limit)
+{
+    max_output_ = std::max(limit, std::size_t{1});
+}
+
+void
+Pokemon_links::set_item_heuristic(Item_heuristic heuristic)
+{
+    item_heuristic_ = heuristic;
+}
+
+/// Reordering a column relinks every node in it so nothing may be spliced out
+/// while we do it. Hidden options and nodes outside of the threshold come
+/// back first and leave again afterward in the new order.
+void
+Pokemon_links::set_column_order(Column_order order)
+{
+    const std::vector<uint64_t> user_hidden = hidden_options_;
+    reset_options();
+    const Multiplier threshold = threshold_;
+    if (!threshold_nodes_.empty())
+    {
+        static_cast<void>(
+            set_threshold(requested_cover_solution_ == defense ? qdr : imm));
+    }
+    std::vector<uint64_t> column{};
+    for (uint64_t header = 1; header < item_table_.size(); ++header)
+    {
+        column.clear();
+        for (uint64_t i = links_[header].down; i != header; i = links_[i].down)
+        {
+            column.push_back(i);
+        }
+        switch (order)
+        {
+        case built_order:
+            std::ranges::sort(column);
+            break;
+        case reversed_order:
+            std::ranges::sort(column, std::greater{});
+            break;
+        case score_order:
+            std::ranges::sort(column, [this](uint64_t a, uint64_t b) {
+                const Multiplier ma = links_[a].multiplier;
+                const Multiplier mb = links_[b].multiplier;
+                if (ma == mb)
+                {
+                    return a < b;
+                }
+                return requested_cover_solution_ == defense ? ma < mb
+                                                            : mb < ma;
+            });
+            break;
+        }
+        uint64_t prev = header;
+        for (const uint64_t i : column)
+        {
+            links_[prev].down = i;
+            links_[i].up = prev;
+            prev = i;
+        }
+        links_[prev].down = header;
+        links_[header].up = prev;
+    }
+    if (!threshold_nodes_.empty())
+    {
+        static_cast<void>(set_threshold(threshold));
+    }
+    for (const uint64_t row : user_hidden)
+    {
+        hidden_options_.push_back(row);
+        hide_option(row);
+    }
+}
+
 uint64_t
 Pokemon_links::get_num_items() const
 {
@@ -1185,8 +3148,29 @@ Pokemon_links::get_hid_options() const
 bool
 Pokemon_links::hide_requested_item(Type_encoding to_hide)
 {
-    const uint64_t lookup_index = find_item_index(to_hide);
-    // Can't find or this item has already been hidden.
+    // Links over several generations hide the item in every generation. Each
+    // generation is its own entry on the hidden stack.
+    bool result = false;
+    for (uint64_t lookup_index = find_item_index(to_hide);
+         lookup_index && lookup_index < secondary_start_
+         && item_table_[lookup_index].name == to_hide;
+         ++lookup_index)
+    {
+        // Can't find or this item has already been hidden.
+        if (links_[lookup_index].tag != hidden)
+        {
+            hidden_items_.push_back(lookup_index);
+            hide_item(lookup_index);
+            result = true;
+        }
+    }
+    return result;
+}
+
+bool
+Pokemon_links::hide_requested_item(int generation, Type_encoding to_hide)
+{
+    const uint64_t lookup_index = find_item_index(to_hide, generation);
     if (lookup_index && links_[lookup_index].tag != hidden)
     {
         hidden_items_.push_back(lookup_index);
@@ -1239,11 +3223,52 @@ Pokemon_links::hide_all_items_except(const std::set<Type_encoding> &to_keep)
     }
 }
 
+/// Moving between selections only pays for what differs. Everything at the
+/// bottom of the hidden stack that stays hidden is left alone and only the
+/// entries above the first item that must return are popped. Anything popped
+/// that should stay hidden is hidden again along with the new items.
+
+bool
+Pokemon_links::set_live_items(const std::vector<bool> &live)
+{
+    if (live.size() != secondary_start_ - 1)
+    {
+        return false;
+    }
+    uint64_t keep = 0;
+    while (keep < hidden_items_.size() && !live[hidden_items_[keep] - 1])
+    {
+        ++keep;
+    }
+    while (hidden_items_.size() > keep)
+    {
+        unhide_item(hidden_items_.back());
+        hidden_items_.pop_back();
+    }
+    for (uint64_t i = 1; i <= live.size(); ++i)
+    {
+        if (!live[i - 1] && links_[i].tag != hidden)
+        {
+            hidden_items_.push_back(i);
+            hide_item(i);
+        }
+    }
+    return true;
+}
+
 bool
 Pokemon_links::has_item(Type_encoding item) const
 {
-    const uint64_t found = find_item_index(item);
-    return found && links_[found].tag != hidden;
+    for (uint64_t found = find_item_index(item);
+         found && found < secondary_start_ && item_table_[found].name == item;
+         ++found)
+    {
+        if (links_[found].tag != hidden)
+        {
+            return true;
+        }
+    }
+    return false;
 }
 
 void
@@ -1297,15 +3322,24 @@ Pokemon_links::reset_items()
 bool
 Pokemon_links::hide_requested_option(Type_encoding to_hide)
 {
-    const uint64_t lookup_index = find_option_index(to_hide);
-    // Couldn't find or this option has already been hidden.
-    if (lookup_index && links_[lookup_index].tag != hidden)
+    // Species links hide every row of the typing. Each row is its own entry
+    // on the hidden stack.
+    bool result = false;
+    for (uint64_t lookup_index = find_option_index(to_hide);
+         lookup_index && lookup_index < option_table_.size()
+         && option_table_[lookup_index].name == to_hide;
+         ++lookup_index)
     {
-        hidden_options_.push_back(lookup_index);
-        hide_option(lookup_index);
-        return true;
+        // Can't find or this option has already been hidden.
+        const uint64_t row = option_table_[lookup_index].index;
+        if (links_[row].tag != hidden)
+        {
+            hidden_options_.push_back(row);
+            hide_option(row);
+            result = true;
+        }
     }
-    return false;
+    return result;
 }
 
 bool
@@ -1356,11 +3390,53 @@ Pokemon_links::hide_all_options_except(const std::set<Type_encoding> &to_keep)
     }
 }
 
+bool
+Pokemon_links::set_live_options(const std::vector<bool> &live)
+{
+    if (live.size() != option_table_.size() - 1)
+    {
+        return false;
+    }
+    // Options splice out of their items so unlike items the stack order is
+    // what keeps the links correct. Only pop down to the first option that
+    // must return.
+    uint64_t keep = 0;
+    while (keep < hidden_options_.size()
+           && !live[std::abs(links_[hidden_options_[keep]].top_or_len) - 1])
+    {
+        ++keep;
+    }
+    while (hidden_options_.size() > keep)
+    {
+        unhide_option(hidden_options_.back());
+        hidden_options_.pop_back();
+    }
+    for (uint64_t i = 1; i <= live.size(); ++i)
+    {
+        const uint64_t row = option_table_[i].index;
+        if (!live[i - 1] && links_[row].tag != hidden)
+        {
+            hidden_options_.push_back(row);
+            hide_option(row);
+        }
+    }
+    return true;
+}
+
 bool
 Pokemon_links::has_option(Type_encoding option) const
 {
-    const uint64_t found = find_option_index(option);
-    return found && links_[found].tag != hidden;
+    for (uint64_t found = find_option_index(option);
+         found && found < option_table_.size()
+         && option_table_[found].name == option;
+         ++found)
+    {
+        if (links_[option_table_[found].index].tag != hidden)
+        {
+            return true;
+        }
+    }
+    return false;
 }
 
 void
@@ -1447,6 +3523,10 @@ Pokemon_links::hide_option(uint64_t row_index)
     links_[row_index].tag = hidden;
     for (uint64_t i = row_index + 1; links_[i].top_or_len > 0; ++i)
     {
+        if (links_[i].tag == hidden)
+        {
+            continue;
+        }
         const Poke_link cur = links_[i];
         links_[cur.up].down = cur.down;
         links_[cur.down].up = cur.up;
@@ -1461,6 +3541,10 @@ Pokemon_links::unhide_option(uint64_t row_index)
     links_[row_index].tag = 0;
     for (uint64_t i = row_index + 1; links_[i].top_or_len > 0; ++i)
     {
+        if (links_[i].tag == hidden)
+        {
+            continue;
+        }
         const Poke_link cur = links_[i];
         links_[cur.up].down = i;
         links_[cur.down].up = i;
@@ -1469,52 +3553,145 @@ Pokemon_links::unhide_option(uint64_t row_index)
     ++num_options_;
 }
 
-uint64_t
-Pokemon_links::find_item_index(Type_encoding item) const
+void
+Pokemon_links::hide_multiplier(Multiplier multiplier)
+{
+    for (const uint64_t i : threshold_nodes_[multiplier])
+    {
+        const Poke_link cur = links_[i];
+        links_[cur.up].down = cur.down;
+        links_[cur.down].up = cur.up;
+        --links_[cur.top_or_len].top_or_len;
+        links_[i].tag = hidden;
+    }
+}
+
+void
+Pokemon_links::unhide_multiplier(Multiplier multiplier)
+{
+    const std::vector<uint64_t> &nodes = threshold_nodes_[multiplier];
+    for (auto i = nodes.rbegin(); i != nodes.rend(); ++i)
+    {
+        const Poke_link cur = links_[*i];
+        links_[cur.up].down = *i;
+        links_[cur.down].up = *i;
+        ++links_[cur.top_or_len].top_or_len;
+        links_[*i].tag = 0;
+    }
+}
+
+bool
+Pokemon_links::set_threshold(Multiplier threshold)
 {
-    for (uint64_t nremain = item_table_.size(), base = 0; nremain != 0;
-         nremain >>= 1)
+    if (threshold_nodes_.empty() || threshold == emp)
+    {
+        return false;
+    }
+    if (threshold == threshold_)
+    {
+        return true;
+    }
+    // Hidden options left the links after the threshold nodes did so they
+    // must come back first to keep every column in last in first out order.
+    const std::vector<uint64_t> user_hidden = hidden_options_;
+    reset_options();
+    // Whole multipliers leave and return as a stack. Defense loses its worst
+    // resistances first while attack loses its weakest hits first.
+    if (requested_cover_solution_ == defense)
+    {
+        for (int m = threshold_; m > threshold; --m)
+        {
+            hide_multiplier(static_cast<Multiplier>(m));
+        }
+        for (int m = threshold_ + 1; m <= threshold; ++m)
+        {
+            unhide_multiplier(static_cast<Multiplier>(m));
+        }
+    }
+    else
     {
-        const uint64_t cur_index = base + (nremain >> 1);
-        if (item_table_[cur_index].name == item)
+        for (int m = threshold_; m < threshold; ++m)
         {
-            // This is the index where we can find the header for this items
-            // column.
-            return cur_index;
+            hide_multiplier(static_cast<Multiplier>(m));
         }
-        if (item > item_table_[cur_index].name)
+        for (int m = threshold_ - 1; m >= threshold; --m)
         {
-            base = cur_index + 1;
-            nremain--;
+            unhide_multiplier(static_cast<Multiplier>(m));
         }
     }
+    threshold_ = threshold;
+    for (const uint64_t row : user_hidden)
+    {
+        hidden_options_.push_back(row);
+        hide_option(row);
+    }
+    return true;
+}
+
+Multiplier
+Pokemon_links::get_threshold() const
+{
+    if (threshold_nodes_.empty())
+    {
+        return requested_cover_solution_ == defense ? f12 : dbl;
+    }
+    return threshold_;
+}
+
+uint64_t
+Pokemon_links::find_item_index(Type_encoding item) const
+{
+    // Secondary items are not sorted and may not be hidden by the user so we
+    // only search the primary items. A lower bound lands on the first of the
+    // items that share a name across generations.
+    const auto first = item_table_.begin() + 1;
+    const auto last = item_table_.begin()
+                      + static_cast<std::ptrdiff_t>(secondary_start_);
+    const auto found = std::lower_bound(
+        first, last, item,
+        [](const Type_name &entry, Type_encoding key) {
+            return entry.name < key;
+        });
     // We know zero holds no value in the itemTable_ and this can double as a
     // falsey value.
-    return 0;
+    if (found == last || found->name != item)
+    {
+        return 0;
+    }
+    return static_cast<uint64_t>(found - item_table_.begin());
 }
 
 uint64_t
-Pokemon_links::find_option_index(Type_encoding option) const
+Pokemon_links::find_item_index(Type_encoding item, int generation) const
 {
-    for (uint64_t nremain = option_table_.size(), base = 0; nremain != 0;
-         nremain >>= 1)
+    for (uint64_t i = find_item_index(item);
+         i && i < secondary_start_ && item_table_[i].name == item; ++i)
     {
-        const uint64_t cur_index = base + (nremain >> 1);
-        if (option_table_[cur_index].name == option)
-        {
-            // This is the index corresponding to the spacer node for an option
-            // in the links.
-            return option_table_[cur_index].index;
-        }
-        if (option > option_table_[cur_index].name)
+        if (item_generations_[i] == generation)
         {
-            base = cur_index + 1;
-            nremain--;
+            return i;
         }
     }
+    return 0;
+}
+
+uint64_t
+Pokemon_links::find_option_index(Type_encoding option) const
+{
+    // A lower bound lands on the first of the species rows that share a name.
+    const auto first = option_table_.begin() + 1;
+    const auto found = std::lower_bound(
+        first, option_table_.end(), option,
+        [](const Encoding_index &entry, Type_encoding key) {
+            return entry.name < key;
+        });
     // We know zero holds no value in the optionTable_ and this can double as a
     // falsey value.
-    return 0;
+    if (found == option_table_.end() || found->name != option)
+    {
+        return 0;
+    }
+    return static_cast<uint64_t>(found - option_table_.begin());
 }
 
 /////////////////////   Constructors and Links Build
@@ -1540,6 +3717,29 @@ Pokemon_links::Pokemon_links(
     }
 }
 
+Pokemon_links::Pokemon_links(
+    const std::map<Type_encoding, std::set<Resistance>> &type_interactions,
+    const Coverage_type requested_cover_solution, const Multiplier threshold)
+    : threshold_nodes_(qdr + 1),
+      threshold_(requested_cover_solution == defense ? qdr : imm),
+      requested_cover_solution_(requested_cover_solution)
+{
+    if (requested_cover_solution == defense)
+    {
+        build_defense_links(type_interactions);
+    }
+    else
+    {
+        build_attack_links(type_interactions);
+    }
+    // Every node starts in the links so the threshold hides what it must.
+    if (!set_threshold(threshold))
+    {
+        std::cerr << "Invalid threshold. Choose x0.0 through x4.\n";
+        std::abort();
+    }
+}
+
 Pokemon_links::Pokemon_links(
     const std::map<Type_encoding, std::set<Resistance>> &type_interactions,
     const std::set<Type_encoding> &attack_types)
@@ -1573,8 +3773,64 @@ Pokemon_links::Pokemon_links(
     }
 }
 
+Pokemon_links::Pokemon_links(
+    const std::map<Type_encoding, std::set<Resistance>> &type_interactions,
+    const std::vector<Team_rule> &rules)
+    : requested_cover_solution_(defense)
+{
+    const bool drop_quad = std::ranges::any_of(rules, [](const Team_rule &r) {
+        return r.rule == no_quad_weakness;
+    });
+    if (!drop_quad)
+    {
+        build_defense_links(type_interactions, rules);
+        return;
+    }
+    // A rule about a single typing is best enforced by never building it.
+    std::map<Type_encoding, std::set<Resistance>> modified_interactions = {};
+    for (const auto &type : type_interactions)
+    {
+        if (std::ranges::none_of(type.second, [](const Resistance &r) {
+                return r.multiplier() == qdr;
+            }))
+        {
+            modified_interactions.insert(type);
+        }
+    }
+    build_defense_links(modified_interactions, rules);
+}
+
+Pokemon_links::Pokemon_links(
+    const std::map<Type_encoding, std::set<Resistance>> &type_interactions,
+    const std::vector<Species> &species)
+    : requested_cover_solution_(defense)
+{
+    build_species_links(type_interactions, species);
+}
+
+Pokemon_links::Pokemon_links(
+    const std::map<int, std::map<Type_encoding, std::set<Resistance>>>
+        &generations,
+    const Coverage_type requested_cover_solution)
+    : requested_cover_solution_(requested_cover_solution)
+{
+    build_combined_links(generations);
+}
+
 void
 Pokemon_links::build_defense_links(
+    const std::map<Type_encoding, std::set<Resistance>> &type_interactions,
+    const std::vector<Team_rule> &rules)
+{
+    std::unordered_map<Type_encoding, uint64_t> column_builder
+        = build_defense_items(type_interactions);
+    initialize_columns(type_interactions, column_builder,
+                       requested_cover_solution_,
+                       build_secondary_items(type_interactions, rules));
+}
+
+std::unordered_map<Type_encoding, uint64_t>
+Pokemon_links::build_defense_items(
     const std::map<Type_encoding, std::set<Resistance>> &type_interactions)
 {
     // We always must gather all attack types available in this query
@@ -1603,20 +3859,170 @@ Pokemon_links::build_defense_links(
         ++index;
     }
     item_table_[item_table_.size() - 1].right = 0;
+    secondary_start_ = item_table_.size();
+    return column_builder;
+}
 
-    initialize_columns(type_interactions, column_builder,
-                       requested_cover_solution_);
+void
+Pokemon_links::build_species_links(
+    const std::map<Type_encoding, std::set<Resistance>> &type_interactions,
+    const std::vector<Species> &species)
+{
+    std::unordered_map<Type_encoding, uint64_t> column_builder
+        = build_defense_items(type_interactions);
+
+    // A row is known by its typing and its multiplier against every attack
+    // type. The set of resistances cannot be the key because resistances
+    // compare by type alone.
+    struct Species_row
+    {
+        std::set<Resistance> resistances;
+        std::vector<std::string> names;
+    };
+    std::map<std::pair<Type_encoding, std::vector<Multiplier>>, Species_row>
+        collapsed = {};
+    for (const Species &s : species)
+    {
+        const auto typing = type_interactions.find(s.type);
+        if (typing == type_interactions.end())
+        {
+            continue;
+        }
+        std::set<Resistance> row = {};
+        std::vector<Multiplier> key = {};
+        for (const Resistance &r : typing->second)
+        {
+            const Multiplier m = s.ability_immunities.contains(r.type())
+                                     ? imm
+                                     : r.multiplier();
+            row.insert({r.type(), m});
+            key.push_back(m);
+        }
+        Species_row &found = collapsed[{s.type, key}];
+        found.resistances = std::move(row);
+        found.names.push_back(s.name);
+    }
+
+    // Rows stay in typing order so options can still be found by name.
+    std::vector<std::pair<Type_encoding, std::set<Resistance>>> rows = {};
+    std::map<Type_encoding, uint64_t> rows_per_typing = {};
+    option_species_.emplace_back();
+    for (auto &[key, row] : collapsed)
+    {
+        rows.emplace_back(key.first, std::move(row.resistances));
+        option_species_.push_back(std::move(row.names));
+        ++rows_per_typing[key.first];
+    }
+    std::vector<std::vector<Secondary_node>> secondary_rows(rows.size());
+    for (uint64_t i = 0; i < rows.size(); ++i)
+    {
+        if (rows_per_typing.at(rows[i].first) < 2)
+        {
+            continue;
+        }
+        // The first row of a typing claims the header for the rest.
+        if (i == 0 || rows[i - 1].first != rows[i].first)
+        {
+            const uint64_t index = item_table_.size();
+            item_table_.push_back({rows[i].first, index, index});
+            links_.push_back({0, index, index, emp, 0});
+        }
+        secondary_rows[i].push_back({item_table_.size() - 1, 0});
+    }
+    initialize_columns(rows, column_builder, requested_cover_solution_,
+                       secondary_rows);
+}
+
+std::vector<std::vector<Pokemon_links::Secondary_node>>
+Pokemon_links::build_secondary_items(
+    const std::map<Type_encoding, std::set<Resistance>> &type_interactions,
+    const std::vector<Team_rule> &rules)
+{
+    std::vector<std::vector<Secondary_node>> rows(type_interactions.size());
+    // Secondary items are not part of the doubly linked item lookup table
+    // because we never choose them. They simply point to themselves.
+    const auto add_header = [this](Type_encoding name) {
+        const uint64_t index = item_table_.size();
+        item_table_.push_back({name, index, index});
+        links_.push_back({0, index, index, emp, 0});
+        return index;
+    };
+    for (const Team_rule &rule : rules)
+    {
+        switch (rule.rule)
+        {
+        case distinct_types: {
+            std::map<uint64_t, uint64_t> single_type_headers = {};
+            for (const auto &type : type_interactions)
+            {
+                const auto [first, second] = type.first.decode_indices();
+                single_type_headers[first] = 0;
+                if (second)
+                {
+                    single_type_headers[second.value()] = 0;
+                }
+            }
+            for (auto &[type_index, header] : single_type_headers)
+            {
+                header = add_header(
+                    Type_encoding(Type_encoding::type_table()[type_index]));
+            }
+            uint64_t option = 0;
+            for (const auto &type : type_interactions)
+            {
+                const auto [first, second] = type.first.decode_indices();
+                rows[option].push_back({single_type_headers.at(first), 0});
+                if (second)
+                {
+                    rows[option].push_back(
+                        {single_type_headers.at(second.value()), 0});
+                }
+                ++option;
+            }
+            break;
+        }
+        case one_weak_to:
+        case same_weakness_to: {
+            const uint64_t header = add_header(rule.type);
+            uint64_t option = 0;
+            for (const auto &type : type_interactions)
+            {
+                const auto found = type.second.find({rule.type, emp});
+                if (found != type.second.end() && nrm < found->multiplier())
+                {
+                    // Colors must be positive so the multiplier works well.
+                    rows[option].push_back(
+                        {header, rule.rule == same_weakness_to
+                                     ? static_cast<int32_t>(found->multiplier())
+                                     : 0});
+                }
+                ++option;
+            }
+            break;
+        }
+        case no_quad_weakness:
+            break;
+        }
+    }
+    return rows;
 }
 
+template <class Rows>
 void
 Pokemon_links::initialize_columns(
-    const std::map<Type_encoding, std::set<Resistance>> &type_interactions,
+    const Rows &type_interactions,
     std::unordered_map<Type_encoding, uint64_t> &column_builder,
-    Coverage_type requested_coverage)
+    Coverage_type requested_coverage,
+    const std::vector<std::vector<Secondary_node>> &secondary_rows)
 {
     uint64_t previous_set_size = links_.size();
     uint64_t current_links_index = links_.size();
     int32_t type_lookup_index = 1;
+    if (requested_coverage == defense)
+    {
+        // Option zero is the empty spacer at the front of the option table.
+        weaknesses_.assign(1, {});
+    }
     for (const auto &type : type_interactions)
     {
 
@@ -1628,6 +4034,19 @@ Pokemon_links::initialize_columns(
                           current_links_index - previous_set_size,
                           current_links_index, emp, 0});
         option_table_.push_back({type.first, current_links_index});
+        if (requested_coverage == defense)
+        {
+            Weakness_profile &profile = weaknesses_.emplace_back();
+            for (const Resistance &r : type.second)
+            {
+                if (nrm < r.multiplier())
+                {
+                    profile.weak |= uint64_t{1}
+                                    << (find_item_index(r.type()) - 1);
+                    profile.quads += r.multiplier() == qdr;
+                }
+            }
+        }
 
         for (const Resistance &single_type : type.second)
         {
@@ -1642,9 +4061,12 @@ Pokemon_links::initialize_columns(
             // for the ATTACK version. We want damage better than Normal,
             // meaining x2 or x4.
 
-            if ((requested_coverage == defense
-                     ? single_type.multiplier() < nrm
-                     : nrm < single_type.multiplier()))
+            // Links built for any threshold keep every interaction and
+            // let the threshold decide who covers what.
+            if (!threshold_nodes_.empty()
+                || (requested_coverage == defense
+                        ? single_type.multiplier() < nrm
+                        : nrm < single_type.multiplier()))
             {
                 ++current_links_index;
                 ++links_[type_title].down;
@@ -1675,8 +4097,31 @@ Pokemon_links::initialize_columns(
                 // Similar to a previous/current coding pattern but in an
                 // above/below column.
                 column_builder[s_type] = current_links_index;
+                if (!threshold_nodes_.empty())
+                {
+                    threshold_nodes_[single_type.multiplier()].push_back(
+                        current_links_index);
+                }
             }
         }
+        // Secondary nodes follow the primary nodes of an option. The tail of
+        // a secondary column is always found above its header.
+        for (const Secondary_node &node :
+             secondary_rows.empty() ? std::vector<Secondary_node>{}
+                                    : secondary_rows[type_lookup_index - 1])
+        {
+            ++current_links_index;
+            ++links_[type_title].down;
+            ++set_size;
+            const uint64_t tail = links_[node.header].up;
+            ++links_[node.header].top_or_len;
+            links_.push_back({static_cast<int>(node.header), tail, node.header,
+                              emp, 0});
+            links_[tail].down = current_links_index;
+            links_[node.header].up = current_links_index;
+            colors_.resize(links_.size(), 0);
+            colors_.back() = node.color;
+        }
         ++type_lookup_index;
         ++current_links_index;
         ++num_options_;
@@ -1684,6 +4129,119 @@ Pokemon_links::initialize_columns(
     }
     links_.push_back(
         {INT_MIN, current_links_index - previous_set_size, UINT64_MAX, emp, 0});
+    if (!colors_.empty())
+    {
+        colors_.resize(links_.size(), 0);
+    }
+}
+
+void
+Pokemon_links::build_combined_links(
+    const std::map<int, std::map<Type_encoding, std::set<Resistance>>>
+        &generations)
+{
+    // Every generation becomes rows of options over its own items. Attack
+    // links invert the map just as single generation attack links do.
+    std::map<int, std::map<Type_encoding, std::set<Resistance>>> rows = {};
+    std::set<std::pair<Type_encoding, int>> items = {};
+    for (const auto &[gen, interactions] : generations)
+    {
+        std::map<Type_encoding, std::set<Resistance>> &gen_rows = rows[gen];
+        for (const auto &[typing, resistances] : interactions)
+        {
+            if (requested_cover_solution_ == defense)
+            {
+                gen_rows[typing] = resistances;
+                for (const Resistance &r : resistances)
+                {
+                    items.insert({r.type(), gen});
+                }
+                continue;
+            }
+            items.insert({typing, gen});
+            for (const Resistance &r : resistances)
+            {
+                gen_rows[r.type()].insert({typing, r.multiplier()});
+            }
+        }
+    }
+    std::set<Type_encoding> shared = {};
+    if (!rows.empty())
+    {
+        for (const auto &row : rows.begin()->second)
+        {
+            if (std::ranges::all_of(rows, [&row](const auto &gen_rows) {
+                    return gen_rows.second.contains(row.first);
+                }))
+            {
+                shared.insert(row.first);
+            }
+        }
+    }
+
+    // Items sort by name and then generation so the copies of an item sit
+    // together and the table stays sorted by name for binary search.
+    option_table_.push_back({Type_encoding(""), 0});
+    item_table_.push_back({Type_encoding(""), 0, 1});
+    item_generations_.push_back(0);
+    links_.push_back({0, 0, 0, emp, 0});
+    std::map<std::pair<Type_encoding, int>, uint64_t> header_of = {};
+    uint64_t index = 1;
+    for (const auto &item : items)
+    {
+        header_of[item] = index;
+        item_table_.push_back({item.first, index - 1, index + 1});
+        item_generations_.push_back(item.second);
+        ++item_table_[0].left;
+        links_.push_back({0, index, index, emp, 0});
+        ++num_items_;
+        ++index;
+    }
+    item_table_[item_table_.size() - 1].right = 0;
+    secondary_start_ = item_table_.size();
+
+    // The first spacer points back to the header node as in single
+    // generation links.
+    uint64_t previous_set_size = links_.size();
+    int32_t type_lookup_index = 1;
+    std::vector<std::pair<uint64_t, Multiplier>> nodes = {};
+    for (const Type_encoding &option : shared)
+    {
+        nodes.clear();
+        for (const auto &[gen, gen_rows] : rows)
+        {
+            for (const Resistance &r : gen_rows.at(option))
+            {
+                if (requested_cover_solution_ == defense
+                        ? r.multiplier() < nrm
+                        : nrm < r.multiplier())
+                {
+                    nodes.emplace_back(header_of.at({r.type(), gen}),
+                                       r.multiplier());
+                }
+            }
+        }
+        std::ranges::sort(nodes);
+        const uint64_t spacer = links_.size();
+        links_.push_back({-type_lookup_index, spacer - previous_set_size,
+                          spacer + nodes.size(), emp, 0});
+        option_table_.push_back({option, spacer});
+        for (const auto &[header, multiplier] : nodes)
+        {
+            const uint64_t node = links_.size();
+            const uint64_t tail = links_[header].up;
+            links_.push_back({static_cast<int>(header), tail, header,
+                              multiplier, 0});
+            links_[tail].down = node;
+            links_[header].up = node;
+            ++links_[header].top_or_len;
+        }
+        previous_set_size = nodes.size();
+        ++type_lookup_index;
+        ++num_options_;
+    }
+    links_.push_back(
+        {INT_MIN, links_.size() - previous_set_size, UINT64_MAX, emp, 0});
 }
 
 void
@@ -1716,6 +4274,7 @@ Pokemon_links::build_attack_links(
         }
     }
     item_table_[item_table_.size() - 1].right = 0;
+    secondary_start_ = item_table_.size();
     initialize_columns(inverted_map, column_builder, requested_cover_solution_);
 }
 
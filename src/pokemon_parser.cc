@@ -3,12 +3,14 @@ module;
 #include <nlohmann/json_fwd.hpp>
 
 #include <array>
+#include <cstdint>
 #include <cstdlib>
 #include <exception>
 #include <fstream>
 #include <iostream>
 #include <istream>
 #include <map>
+#include <optional>
 #include <set>
 #include <stdexcept>
 #include <string>
@@ -16,6 +18,7 @@ module;
 #include <utility>
 #include <vector>
 export module dancing_links:pokemon_parser;
+import :json_scan;
 import :map_parser;
 import :resistance;
 import :type_encoding;
@@ -45,6 +48,15 @@ export namespace Dancing_links {
 /// labelling it with identifying info, even if there is not generation
 /// specification.
 
+/// The type charts and gym files are read with the structural scanner unless
+/// a parsed document is requested. The scanner falls back to the full parser
+/// by itself on any file it does not understand.
+enum Json_reader
+{
+    scanned_json,
+    parsed_json
+};
+
 struct Pokemon_test
 {
     /// This map will hold all types--dual types included--and a map of defense
@@ -70,9 +82,10 @@ Pokemon_test load_pokemon_generation(std::istream &source);
 /// generation's map in the Pokemon Planning GUI.
 /// @param source the file with the map that gives us info on which gen to
 /// build.
+/// @param reader how to read the type chart json.
 /// @return the completed pokemon test with map drawing and Pokemon info.
 std::map<Type_encoding, std::set<Resistance>>
-load_interaction_map(std::istream &source);
+load_interaction_map(std::istream &source, Json_reader reader = scanned_json);
 
 /// @brief load_selected_gyms_defenses when interacting with the GUI, the user
 /// can choose subsets of gyms on the current map they are viewing. If they make
@@ -98,6 +111,39 @@ std::set<Type_encoding>
 load_selected_gyms_attacks(const std::string &selected_map,
                            const std::set<std::string> &selected);
 
+/// The attack types a gym uses and the defensive types its Pokemon have.
+struct Gym_types
+{
+    std::set<Type_encoding> attack;
+    std::set<Type_encoding> defense;
+};
+
+/// @brief load_map_gyms reads every gym for a map in one pass over the map
+/// data. Programs that ask about many gym selections on the same map should
+/// load the gyms once here rather than once per selection.
+/// @param selected_map the .dst file name of the map, as in the map data.
+/// @param reader how to read the map json.
+/// @return every gym name on the map and its attack and defense types.
+std::map<std::string, Gym_types>
+load_map_gyms(const std::string &selected_map,
+              Json_reader reader = scanned_json);
+
+/// A Pokemon species, its typing, and any attack types an ability makes it
+/// immune to, such as Ground for Levitate or Water for Water Absorb.
+struct Species
+{
+    std::string name;
+    Type_encoding type;
+    std::set<Type_encoding> ability_immunities;
+};
+
+/// @brief load_species reads a species file such as the sample in
+/// data/json/species-sample.json. Each species names its typing and may list
+/// the attack types its ability makes it immune to.
+/// @param path_to_json the species json file.
+/// @return every species in the file sorted by name.
+std::vector<Species> load_species(std::string_view path_to_json);
+
 } // namespace Dancing_links
 
 ///////////////////////////////////////   Implementation
@@ -111,6 +157,8 @@ namespace nlo = nlohmann;
 constexpr std::string_view json_all_maps_file = "data/json/all-maps.json";
 constexpr std::string_view gym_attacks_key = "attack";
 constexpr std::string_view gym_defense_key = "defense";
+constexpr std::string_view species_type_key = "type";
+constexpr std::string_view species_immune_key = "immune";
 
 // There is no 0th generation so we will make it easier to select the right file
 // by leaving 0 "".
@@ -137,8 +185,8 @@ const std::array<std::pair<std::string_view, Multiplier>, 6> damage_multipliers
         {"quad", qdr},
     }};
 
-const Multiplier &
-get_multiplier(const std::string &key)
+std::optional<Multiplier>
+find_multiplier(std::string_view key)
 {
     for (const auto &mult : damage_multipliers)
     {
@@ -147,7 +195,18 @@ get_multiplier(const std::string &key)
             return mult.second;
         }
     }
-    throw std::logic_error("Out of bounds. Key not found. ");
+    return {};
+}
+
+Multiplier
+get_multiplier(const std::string &key)
+{
+    const std::optional<Multiplier> found = find_multiplier(key);
+    if (!found)
+    {
+        throw std::logic_error("Out of bounds. Key not found. ");
+    }
+    return *found;
 }
 
 void
@@ -198,10 +257,202 @@ set_resistances(std::map<Type_encoding, std::set<Resistance>> &result,
     }
 }
 
+/// Reads a whole file in one call so the scanner sees contiguous bytes.
+std::optional<std::string>
+read_file(std::string_view path)
+{
+    std::ifstream file(std::string{path}, std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+    {
+        return {};
+    }
+    std::string bytes(static_cast<uint64_t>(file.tellg()), '\0');
+    file.seekg(0);
+    if (!file.read(bytes.data(), static_cast<std::streamsize>(bytes.size())))
+    {
+        return {};
+    }
+    return bytes;
+}
+
+/// Reads ["Type", ...] handing each type to the sink. Any other shape fails.
+template <class Sink>
+bool
+scan_types(Json_scan &scan, Sink sink)
+{
+    if (!scan.consume('['))
+    {
+        return false;
+    }
+    if (scan.consume(']'))
+    {
+        return true;
+    }
+    do
+    {
+        const std::optional<std::string_view> type = scan.string();
+        if (!type)
+        {
+            return false;
+        }
+        sink(Type_encoding(*type));
+    } while (scan.consume(','));
+    return scan.consume(']');
+}
+
+/// A type chart is {"Type": {"multiplier": ["Type", ...], ...}, ...}.
+std::optional<std::map<Type_encoding, std::set<Resistance>>>
+scan_type_chart(Json_scan &scan)
+{
+    std::map<Type_encoding, std::set<Resistance>> result = {};
+    if (!scan.consume('{'))
+    {
+        return {};
+    }
+    if (scan.consume('}'))
+    {
+        return result;
+    }
+    do
+    {
+        const std::optional<std::string_view> type = scan.string();
+        if (!type || !scan.consume(':') || !scan.consume('{'))
+        {
+            return {};
+        }
+        std::set<Resistance> &resistances = result[Type_encoding(*type)];
+        if (scan.consume('}'))
+        {
+            continue;
+        }
+        do
+        {
+            const std::optional<std::string_view> key = scan.string();
+            const std::optional<Multiplier> multiplier
+                = key ? find_multiplier(*key) : std::nullopt;
+            if (!multiplier || !scan.consume(':')
+                || !scan_types(scan, [&](Type_encoding attack) {
+                       resistances.insert({attack, *multiplier});
+                   }))
+            {
+                return {};
+            }
+        } while (scan.consume(','));
+        if (!scan.consume('}'))
+        {
+            return {};
+        }
+    } while (scan.consume(','));
+    if (!scan.consume('}') || !scan.at_end())
+    {
+        return {};
+    }
+    return result;
+}
+
+/// The map file is {"Map.dst": {"Gym": {"attack": [...], "defense": [...]}}}
+/// and only the selected map is read. Every other map is skipped over by its
+/// brackets without reading a string.
+std::optional<std::map<std::string, Gym_types>>
+scan_map_gyms(Json_scan &scan, std::string_view selected_map)
+{
+    if (!scan.consume('{') || scan.consume('}'))
+    {
+        return {};
+    }
+    do
+    {
+        const std::optional<std::string_view> map = scan.string();
+        if (!map || !scan.consume(':'))
+        {
+            return {};
+        }
+        if (*map != selected_map)
+        {
+            if (!scan.skip_value())
+            {
+                return {};
+            }
+            continue;
+        }
+        std::map<std::string, Gym_types> result = {};
+        if (!scan.consume('{'))
+        {
+            return {};
+        }
+        if (scan.consume('}'))
+        {
+            return result;
+        }
+        do
+        {
+            const std::optional<std::string_view> gym = scan.string();
+            if (!gym || !scan.consume(':') || !scan.consume('{'))
+            {
+                return {};
+            }
+            Gym_types &types = result[std::string(*gym)];
+            if (scan.consume('}'))
+            {
+                continue;
+            }
+            do
+            {
+                const std::optional<std::string_view> key = scan.string();
+                if (!key || !scan.consume(':'))
+                {
+                    return {};
+                }
+                if (*key == gym_attacks_key || *key == gym_defense_key)
+                {
+                    std::set<Type_encoding> &into = *key == gym_attacks_key
+                                                        ? types.attack
+                                                        : types.defense;
+                    if (!scan_types(scan, [&into](Type_encoding type) {
+                            into.insert(type);
+                        }))
+                    {
+                        return {};
+                    }
+                }
+                else if (!scan.skip_value())
+                {
+                    return {};
+                }
+            } while (scan.consume(','));
+            if (!scan.consume('}'))
+            {
+                return {};
+            }
+        } while (scan.consume(','));
+        if (!scan.consume('}'))
+        {
+            return {};
+        }
+        return result;
+    } while (scan.consume(','));
+    // The map is not in the file. The full parser reports it.
+    return {};
+}
+
 std::map<Type_encoding, std::set<Resistance>>
-from_json_to_map(int generation)
+from_json_to_map(int generation, Json_reader reader)
 {
     const std::string_view path_to_json = generation_json_files.at(generation);
+    if (reader == scanned_json)
+    {
+        if (std::optional<std::string> bytes = read_file(path_to_json))
+        {
+            Json_scan scan(std::move(*bytes));
+            if (scan.ok())
+            {
+                if (auto chart = scan_type_chart(scan))
+                {
+                    return std::move(*chart);
+                }
+            }
+        }
+    }
     const nlo::json json_types = get_json_object(path_to_json);
     std::map<Type_encoding, std::set<Resistance>> result = {};
     for (const auto &[type, resistances] : json_types.items())
@@ -214,7 +465,7 @@ from_json_to_map(int generation)
 }
 
 std::map<Type_encoding, std::set<Resistance>>
-load_generation_from_json(std::istream &source)
+load_generation_from_json(std::istream &source, Json_reader reader)
 {
     std::string line;
     std::getline(source, line);
@@ -222,7 +473,7 @@ load_generation_from_json(std::istream &source)
     try
     {
         const int generation = std::stoi(after_hashtag);
-        return from_json_to_map(generation);
+        return from_json_to_map(generation, reader);
     } catch (const std::out_of_range &oor)
     {
         print_generation_error(oor);
@@ -240,15 +491,15 @@ Pokemon_test
 load_pokemon_generation(std::istream &source)
 {
     Pokemon_test generation;
-    generation.interactions = load_generation_from_json(source);
+    generation.interactions = load_generation_from_json(source, scanned_json);
     generation.gen_map = load_map(source);
     return generation;
 }
 
 std::map<Type_encoding, std::set<Resistance>>
-load_interaction_map(std::istream &source)
+load_interaction_map(std::istream &source, Json_reader reader)
 {
-    return load_generation_from_json(source);
+    return load_generation_from_json(source, reader);
 }
 
 std::set<Type_encoding>
@@ -260,25 +511,18 @@ load_selected_gyms_defenses(const std::string &selected_map,
         std::cerr
             << "Requesting to load zero gyms check selected gyms input.\n";
     }
-    const nlo::json map_data = get_json_object(json_all_maps_file);
+    const std::map<std::string, Gym_types> gyms = load_map_gyms(selected_map);
     std::set<Type_encoding> result = {};
-
-    const nlo::json &gym_keys = map_data.at(selected_map);
-
     std::vector<std::string_view> confirmed{};
     confirmed.reserve(selected_gyms.size());
-    for (const auto &[gym, attack_defense_map] : gym_keys.items())
+    for (const auto &[gym, types] : gyms)
     {
         if (!selected_gyms.contains(gym))
         {
             continue;
         }
         confirmed.push_back(gym);
-        for (const auto &t : attack_defense_map.at(gym_defense_key))
-        {
-            const std::string &type = t;
-            result.insert(Type_encoding(type));
-        }
+        result.insert(types.defense.begin(), types.defense.end());
     }
     if (confirmed.size() != selected_gyms.size())
     {
@@ -308,24 +552,18 @@ load_selected_gyms_attacks(const std::string &selected_map,
         std::cerr
             << "Requesting to load zero gyms check selected gyms input.\n";
     }
-    const nlo::json map_data = get_json_object(json_all_maps_file);
+    const std::map<std::string, Gym_types> gyms = load_map_gyms(selected_map);
     std::set<Type_encoding> result = {};
-    const nlo::json &selection = map_data.at(selected_map);
-
     std::vector<std::string_view> confirmed{};
     confirmed.reserve(selected_gyms.size());
-    for (const auto &[gym, attack_defense_map] : selection.items())
+    for (const auto &[gym, types] : gyms)
     {
         if (!selected_gyms.contains(gym))
         {
             continue;
         }
         confirmed.push_back(gym);
-        for (const auto &t : attack_defense_map.at(gym_attacks_key))
-        {
-            const std::string &type = t;
-            result.insert(Type_encoding(type));
-        }
+        result.insert(types.attack.begin(), types.attack.end());
     }
     if (confirmed.size() != selected_gyms.size())
     {
@@ -346,4 +584,65 @@ load_selected_gyms_attacks(const std::string &selected_map,
     return result;
 }
 
+std::map<std::string, Gym_types>
+load_map_gyms(const std::string &selected_map, Json_reader reader)
+{
+    if (reader == scanned_json)
+    {
+        if (std::optional<std::string> bytes = read_file(json_all_maps_file))
+        {
+            Json_scan scan(std::move(*bytes));
+            if (scan.ok())
+            {
+                if (auto gyms = scan_map_gyms(scan, selected_map))
+                {
+                    return std::move(*gyms);
+                }
+            }
+        }
+    }
+    const nlo::json map_data = get_json_object(json_all_maps_file);
+    std::map<std::string, Gym_types> result = {};
+    for (const auto &[gym, attack_defense_map] :
+         map_data.at(selected_map).items())
+    {
+        Gym_types &types = result[gym];
+        for (const auto &t : attack_defense_map.at(gym_attacks_key))
+        {
+            const std::string &type = t;
+            types.attack.insert(Type_encoding(type));
+        }
+        for (const auto &t : attack_defense_map.at(gym_defense_key))
+        {
+            const std::string &type = t;
+            types.defense.insert(Type_encoding(type));
+        }
+    }
+    return result;
+}
+
+std::vector<Species>
+load_species(std::string_view path_to_json)
+{
+    const nlo::json species_data = get_json_object(path_to_json);
+    std::vector<Species> result{};
+    result.reserve(species_data.size());
+    for (const auto &[name, info] : species_data.items())
+    {
+        const std::string &type = info.at(species_type_key);
+        result.push_back({name, Type_encoding(type), {}});
+        Species &species = result.back();
+        if (!info.contains(species_immune_key))
+        {
+            continue;
+        }
+        for (const auto &t : info.at(species_immune_key))
+        {
+            const std::string &immune = t;
+            species.ability_immunities.insert(Type_encoding(immune));
+        }
+    }
+    return result;
+}
+
 } // namespace Dancing_links
@@ -0,0 +1,278 @@
+/// Author: Alexander Lopez File: portfolio.cc
+/// ----------------------
+/// How long a search takes to find its first cover, or its best few covers,
+/// depends heavily on which item it covers next, the order it tries options,
+/// and the engine doing the work. There is no single best choice for every
+/// map and gym selection. A portfolio races several configurations on their
+/// own copies of the links, one thread each. The first configuration to
+/// finish wins and every other is cancelled through a shared stop token. If
+/// the deadline arrives first, the configuration holding the best covers so
+/// far wins.
+module;
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <set>
+#include <stop_token>
+#include <thread>
+#include <utility>
+#include <vector>
+export module dancing_links:portfolio;
+import :pokemon_links;
+import :ranked_set;
+import :type_encoding;
+
+/////////////////////////////////////////   Exported Interface
+
+export namespace Dancing_links {
+
+enum Portfolio_engine
+{
+    stack_engine,
+    recursive_engine,
+    trail_engine // Undoes branches from a log of link writes.
+};
+
+struct Portfolio_config
+{
+    Pokemon_links::Item_heuristic heuristic{Pokemon_links::fewest_options};
+    Pokemon_links::Column_order order{Pokemon_links::built_order};
+    Portfolio_engine engine{stack_engine};
+};
+
+struct Portfolio_result
+{
+    std::vector<Ranked_set<Type_encoding>> covers; // Best cover first.
+    Portfolio_config winner;
+    Pokemon_links::Search_status status;
+};
+
+/// @brief default_portfolio a spread of configurations that disagree about
+/// item choice, option order, and engine.
+/// @return the configurations to race.
+std::vector<Portfolio_config> default_portfolio();
+
+/// @brief portfolio_first_cover races the configurations for any one cover.
+/// @param links the links to search. Every configuration copies them so the
+/// caller may have hidden items or options as usual.
+/// @param overlapping true for an overlapping cover, false for exact.
+/// @param choice_limit size of a pokemon team or the number of attacks.
+/// @param configs the configurations to race, one thread each.
+/// @param deadline optional time at which every configuration must stop.
+/// @return at most one cover and the configuration that found it first.
+Portfolio_result portfolio_first_cover(
+    const Pokemon_links &links, bool overlapping, int choice_limit,
+    const std::vector<Portfolio_config> &configs,
+    std::optional<std::chrono::steady_clock::time_point> deadline = {});
+
+/// @brief portfolio_best_covers races the configurations for the k best
+/// covers. Lower rank is better for defense and higher rank for attack with
+/// smaller covers breaking ties. A configuration that completes its search
+/// has found the true best covers and wins immediately.
+/// @param links the links to search.
+/// @param overlapping true for overlapping covers, false for exact.
+/// @param choice_limit size of a pokemon team or the number of attacks.
+/// @param k the number of covers wanted.
+/// @param configs the configurations to race, one thread each.
+/// @param deadline optional time at which every configuration must stop.
+/// @return up to k covers, best first, and the configuration that won.
+Portfolio_result portfolio_best_covers(
+    const Pokemon_links &links, bool overlapping, int choice_limit, uint64_t k,
+    const std::vector<Portfolio_config> &configs,
+    std::optional<std::chrono::steady_clock::time_point> deadline = {});
+
+} // namespace Dancing_links
+
+////////////////////////////////////////   Implementation
+
+namespace Dancing_links {
+
+namespace {
+
+struct Portfolio_run
+{
+    std::vector<Ranked_set<Type_encoding>> covers;
+    Pokemon_links::Search_status status;
+};
+
+bool
+better_cover(const Ranked_set<Type_encoding> &a,
+             const Ranked_set<Type_encoding> &b,
+             Pokemon_links::Coverage_type type)
+{
+    if (a.rank() != b.rank())
+    {
+        return type == Pokemon_links::defense ? a.rank() < b.rank()
+                                              : a.rank() > b.rank();
+    }
+    if (a.size() != b.size())
+    {
+        return a.size() < b.size();
+    }
+    return a < b;
+}
+
+std::vector<Ranked_set<Type_encoding>>
+best_of(const std::set<Ranked_set<Type_encoding>> &covers, uint64_t k,
+        Pokemon_links::Coverage_type type)
+{
+    std::vector<Ranked_set<Type_encoding>> result(covers.begin(),
+                                                  covers.end());
+    const auto better = [type](const auto &a, const auto &b) {
+        return better_cover(a, b, type);
+    };
+    const auto keep = result.begin() + static_cast<std::ptrdiff_t>(
+                          std::min<uint64_t>(k, result.size()));
+    std::ranges::partial_sort(result, keep, better);
+    result.erase(keep, result.end());
+    return result;
+}
+
+/// A partial run is better than another if its best covers are better in
+/// order, or it has more of them when they agree.
+bool
+better_run(const Portfolio_run &a, const Portfolio_run &b,
+           Pokemon_links::Coverage_type type)
+{
+    for (uint64_t i = 0; i < a.covers.size() && i < b.covers.size(); ++i)
+    {
+        if (better_cover(a.covers[i], b.covers[i], type))
+        {
+            return true;
+        }
+        if (better_cover(b.covers[i], a.covers[i], type))
+        {
+            return false;
+        }
+    }
+    return a.covers.size() > b.covers.size();
+}
+
+/// Every engine finds the same covers. They differ only in how they get
+/// there.
+std::set<Ranked_set<Type_encoding>>
+search(Pokemon_links &links, Portfolio_engine engine, bool overlapping,
+       int choice_limit)
+{
+    switch (engine)
+    {
+    case recursive_engine:
+        return overlapping
+                   ? links.overlapping_coverages_functional(choice_limit)
+                   : links.exact_coverages_functional(choice_limit);
+    case trail_engine:
+        return overlapping ? links.overlapping_coverages_trail(choice_limit)
+                           : links.exact_coverages_trail(choice_limit);
+    case stack_engine:
+        break;
+    }
+    return overlapping ? links.overlapping_coverages_stack(choice_limit)
+                       : links.exact_coverages_stack(choice_limit);
+}
+
+Portfolio_result
+race(const Pokemon_links &links, bool overlapping, int choice_limit,
+     uint64_t k, const std::vector<Portfolio_config> &configs,
+     std::optional<std::chrono::steady_clock::time_point> deadline)
+{
+    const Pokemon_links::Coverage_type type = links.get_links_type();
+    std::vector<Portfolio_run> runs(configs.size());
+    std::stop_source source{};
+    std::atomic<int> winner{-1};
+    {
+        std::vector<std::jthread> racers{};
+        racers.reserve(configs.size());
+        for (uint64_t c = 0; c < configs.size(); ++c)
+        {
+            racers.emplace_back([&, c] {
+                Pokemon_links local = links;
+                local.set_item_heuristic(configs[c].heuristic);
+                local.set_column_order(configs[c].order);
+                local.set_stop_token(source.get_token());
+                if (deadline)
+                {
+                    local.set_deadline(*deadline);
+                }
+                // Asking for one cover is the output limit of one.
+                if (k == 1)
+                {
+                    local.set_output_limit(1);
+                }
+                const std::set<Ranked_set<Type_encoding>> covers = search(
+                    local, configs[c].engine, overlapping, choice_limit);
+                runs[c] = {best_of(covers, k, type),
+                           local.get_search_status()};
+                // A search that ran to the end cannot be beaten and a first
+                // cover cannot be improved on.
+                const bool done
+                    = runs[c].status == Pokemon_links::complete
+                      || (k == 1 && !runs[c].covers.empty());
+                int expected = -1;
+                if (done && winner.compare_exchange_strong(expected,
+                                                           static_cast<int>(c)))
+                {
+                    source.request_stop();
+                }
+            });
+        }
+    }
+    if (runs.empty())
+    {
+        return {{}, {}, Pokemon_links::complete};
+    }
+    int chosen = winner.load();
+    if (chosen < 0)
+    {
+        // The deadline arrived first. Settle for the best partial work.
+        chosen = 0;
+        for (uint64_t c = 1; c < runs.size(); ++c)
+        {
+            if (better_run(runs[c], runs[chosen], type))
+            {
+                chosen = static_cast<int>(c);
+            }
+        }
+    }
+    return {std::move(runs[chosen].covers), configs[chosen],
+            runs[chosen].status};
+}
+
+} // namespace
+
+std::vector<Portfolio_config>
+default_portfolio()
+{
+    return {
+        {Pokemon_links::fewest_options, Pokemon_links::built_order,
+         stack_engine},
+        {Pokemon_links::fewest_options, Pokemon_links::score_order,
+         stack_engine},
+        {Pokemon_links::fewest_options_last, Pokemon_links::reversed_order,
+         trail_engine},
+        {Pokemon_links::first_item, Pokemon_links::score_order,
+         recursive_engine},
+    };
+}
+
+Portfolio_result
+portfolio_first_cover(
+    const Pokemon_links &links, bool overlapping, int choice_limit,
+    const std::vector<Portfolio_config> &configs,
+    std::optional<std::chrono::steady_clock::time_point> deadline)
+{
+    return race(links, overlapping, choice_limit, 1, configs, deadline);
+}
+
+Portfolio_result
+portfolio_best_covers(
+    const Pokemon_links &links, bool overlapping, int choice_limit, uint64_t k,
+    const std::vector<Portfolio_config> &configs,
+    std::optional<std::chrono::steady_clock::time_point> deadline)
+{
+    return race(links, overlapping, choice_limit, k, configs, deadline);
+}
+
+} // namespace Dancing_links
@@ -0,0 +1,396 @@
+/// Author: Alexander Lopez File: team_analysis.cc
+/// ----------------------
+/// A search can hand back hundreds of thousands of covers and we usually want
+/// to know more about each of them than their rank. Looking every member up
+/// in the map of sets the links are built from is slow at that scale. These
+/// kernels first flatten the interactions into a dense chart of bit masks and
+/// the covers into one flat arena, slot by slot. The arena copies the masks of
+/// every member out of the chart once when it is built so every metric is a
+/// plain loop over contiguous arrays of integers that the compiler can
+/// vectorize, with no lookups by typing inside the loop.
+/// Filtering and sorting work on index arrays and never copy a cover.
+module;
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <span>
+#include <vector>
+export module dancing_links:team_analysis;
+import :ranked_set;
+import :resistance;
+import :type_encoding;
+
+/////////////////////////////////////////   Exported Interface
+
+export namespace Dancing_links {
+
+/// Every typing of a generation and its interactions with every attack type
+/// as bit masks over the attack types.
+class Dense_chart {
+  public:
+    explicit Dense_chart(
+        const std::map<Type_encoding, std::set<Resistance>> &interactions);
+
+    /// @brief typing_index the row of a typing in the chart.
+    /// @return the row or num_typings() if the typing is not in the chart.
+    [[nodiscard]] uint32_t typing_index(Type_encoding typing) const;
+
+    /// @brief attack_mask the bits of the given attack types, such as the
+    /// attacks found at a gym.
+    [[nodiscard]] uint32_t
+    attack_mask(const std::set<Type_encoding> &attacks) const;
+
+    [[nodiscard]] Multiplier multiplier(uint32_t typing, uint32_t attack) const;
+
+    [[nodiscard]] uint32_t num_typings() const;
+
+    [[nodiscard]] uint32_t num_attacks() const;
+
+    // One entry per typing and a final entry of zeros that pads short covers.
+    [[nodiscard]] std::span<const uint32_t> weak_masks() const;
+    [[nodiscard]] std::span<const uint32_t> resist_masks() const;
+    [[nodiscard]] std::span<const uint32_t> single_type_masks() const;
+    [[nodiscard]] std::span<const uint32_t> quad_counts() const;
+
+  private:
+    std::vector<Type_encoding> typings_;
+    std::vector<Type_encoding> attacks_;
+    std::vector<Multiplier> chart_; // Row major by typing.
+    std::vector<uint32_t> weak_;
+    std::vector<uint32_t> resist_;
+    std::vector<uint32_t> singles_;
+    std::vector<uint32_t> quads_;
+};
+
+/// Covers stored slot by slot. Member s of cover c is at s * size + c and
+/// covers smaller than the widest are padded with the zero row of the chart.
+/// The chart masks of each member sit at the same position in their columns.
+struct Cover_arena
+{
+    uint32_t stride;
+    uint64_t size;
+    std::vector<uint32_t> members; // Rows of the chart.
+    std::vector<uint32_t> weak;
+    std::vector<uint32_t> resist;
+    std::vector<uint32_t> singles;
+    std::vector<uint32_t> quads;
+    std::vector<int32_t> ranks;
+};
+
+enum Team_metric
+{
+    weakness_union,  // Attack types any member is weak to. Lower is better.
+    quad_weaknesses, // x4 weaknesses of every member. Lower is better.
+    gyms_resisted,   // Gyms whose every attack the team resists. Higher wins.
+    type_overlap     // Single types held by two or more members. Lower wins.
+};
+
+/// One column per metric with one entry per cover in arena order.
+struct Team_metrics
+{
+    std::vector<uint32_t> weakness_union;
+    std::vector<uint32_t> quad_weaknesses;
+    std::vector<uint32_t> gyms_resisted;
+    std::vector<uint32_t> type_overlap;
+};
+
+/// @brief make_cover_arena flattens defensive covers into an arena.
+/// @param chart the chart of the generation the covers came from.
+/// @param covers the covers of a search.
+/// @return the arena in the order of the set.
+Cover_arena make_cover_arena(const Dense_chart &chart,
+                             const std::set<Ranked_set<Type_encoding>> &covers);
+
+/// @brief analyze_covers computes every metric for every cover in one pass
+/// per slot of the arena.
+/// @param arena the covers.
+/// @param gym_attacks the attack mask of every gym to check, usually from
+/// Dense_chart::attack_mask.
+/// @return the metrics of every cover.
+Team_metrics analyze_covers(const Cover_arena &arena,
+                            const std::vector<uint32_t> &gym_attacks);
+
+/// @brief metric_column the values of one metric for every cover.
+[[nodiscard]] std::span<const uint32_t>
+metric_column(const Team_metrics &metrics, Team_metric metric);
+
+/// @brief filter_covers writes the index of every cover that is no worse than
+/// the limit on the metric into out. The storage of out is reused.
+void filter_covers(const Team_metrics &metrics, Team_metric metric,
+                   uint32_t limit, std::vector<uint32_t> &out);
+
+/// @brief sort_covers orders cover indices from best to worst on the metric.
+/// Ties keep their order so sorts on several metrics may be chained.
+/// @param metrics the metrics of the covers.
+/// @param metric the metric to sort by.
+/// @param order the indices to sort. If empty it is filled with every cover.
+void sort_covers(const Team_metrics &metrics, Team_metric metric,
+                 std::vector<uint32_t> &order);
+
+} // namespace Dancing_links
+
+////////////////////////////////////////   Implementation
+
+namespace Dancing_links {
+
+Dense_chart::Dense_chart(
+    const std::map<Type_encoding, std::set<Resistance>> &interactions)
+{
+    if (interactions.empty())
+    {
+        weak_ = resist_ = singles_ = quads_ = {0};
+        return;
+    }
+    for (const Resistance &r : interactions.begin()->second)
+    {
+        attacks_.push_back(r.type());
+    }
+    typings_.reserve(interactions.size());
+    chart_.reserve(interactions.size() * attacks_.size());
+    for (const auto &[typing, resistances] : interactions)
+    {
+        typings_.push_back(typing);
+        uint32_t weak = 0;
+        uint32_t resist = 0;
+        uint32_t quads = 0;
+        uint32_t bit = 0;
+        for (const Resistance &r : resistances)
+        {
+            chart_.push_back(r.multiplier());
+            weak |= static_cast<uint32_t>(nrm < r.multiplier()) << bit;
+            resist |= static_cast<uint32_t>(r.multiplier() < nrm) << bit;
+            quads += r.multiplier() == qdr;
+            ++bit;
+        }
+        weak_.push_back(weak);
+        resist_.push_back(resist);
+        singles_.push_back(typing.encoding());
+        quads_.push_back(quads);
+    }
+    weak_.push_back(0);
+    resist_.push_back(0);
+    singles_.push_back(0);
+    quads_.push_back(0);
+}
+
+uint32_t
+Dense_chart::typing_index(Type_encoding typing) const
+{
+    const auto found = std::ranges::lower_bound(typings_, typing);
+    if (found == typings_.end() || *found != typing)
+    {
+        return num_typings();
+    }
+    return static_cast<uint32_t>(found - typings_.begin());
+}
+
+uint32_t
+Dense_chart::attack_mask(const std::set<Type_encoding> &attacks) const
+{
+    uint32_t mask = 0;
+    for (uint32_t a = 0; a < attacks_.size(); ++a)
+    {
+        mask |= static_cast<uint32_t>(attacks.contains(attacks_[a])) << a;
+    }
+    return mask;
+}
+
+Multiplier
+Dense_chart::multiplier(uint32_t typing, uint32_t attack) const
+{
+    return chart_[(static_cast<uint64_t>(typing) * attacks_.size()) + attack];
+}
+
+uint32_t
+Dense_chart::num_typings() const
+{
+    return static_cast<uint32_t>(typings_.size());
+}
+
+uint32_t
+Dense_chart::num_attacks() const
+{
+    return static_cast<uint32_t>(attacks_.size());
+}
+
+std::span<const uint32_t>
+Dense_chart::weak_masks() const
+{
+    return weak_;
+}
+
+std::span<const uint32_t>
+Dense_chart::resist_masks() const
+{
+    return resist_;
+}
+
+std::span<const uint32_t>
+Dense_chart::single_type_masks() const
+{
+    return singles_;
+}
+
+std::span<const uint32_t>
+Dense_chart::quad_counts() const
+{
+    return quads_;
+}
+
+Cover_arena
+make_cover_arena(const Dense_chart &chart,
+                 const std::set<Ranked_set<Type_encoding>> &covers)
+{
+    Cover_arena arena{0, covers.size(), {}, {}, {}, {}, {}, {}};
+    for (const Ranked_set<Type_encoding> &cover : covers)
+    {
+        arena.stride
+            = std::max(arena.stride, static_cast<uint32_t>(cover.size()));
+    }
+    arena.members.assign(arena.stride * arena.size, chart.num_typings());
+    arena.ranks.reserve(arena.size);
+    uint64_t c = 0;
+    for (const Ranked_set<Type_encoding> &cover : covers)
+    {
+        uint64_t slot = 0;
+        for (const Type_encoding &member : cover)
+        {
+            arena.members[(slot * arena.size) + c] = chart.typing_index(member);
+            ++slot;
+        }
+        arena.ranks.push_back(cover.rank());
+        ++c;
+    }
+    // One gather here so the kernels never index the chart by member.
+    const auto gather = [&arena](std::span<const uint32_t> masks) {
+        std::vector<uint32_t> column(arena.members.size());
+        for (uint64_t i = 0; i < column.size(); ++i)
+        {
+            column[i] = masks[arena.members[i]];
+        }
+        return column;
+    };
+    arena.weak = gather(chart.weak_masks());
+    arena.resist = gather(chart.resist_masks());
+    arena.singles = gather(chart.single_type_masks());
+    arena.quads = gather(chart.quad_counts());
+    return arena;
+}
+
+Team_metrics
+analyze_covers(const Cover_arena &arena,
+               const std::vector<uint32_t> &gym_attacks)
+{
+    const uint64_t n = arena.size;
+    std::vector<uint32_t> weak(n, 0);
+    std::vector<uint32_t> resist(n, 0);
+    std::vector<uint32_t> seen(n, 0);
+    std::vector<uint32_t> shared(n, 0);
+    Team_metrics metrics{{}, std::vector<uint32_t>(n, 0),
+                         std::vector<uint32_t>(n, 0), {}};
+    uint32_t *const quads = metrics.quad_weaknesses.data();
+    // Each metric takes its own branch free pass over a slot. A loop that
+    // touches only two or three arrays is one the compiler can prove safe to
+    // vectorize, where one fused loop over all of them is not.
+    for (uint64_t slot = 0; slot < arena.stride; ++slot)
+    {
+        const uint32_t *const weak_masks = arena.weak.data() + (slot * n);
+        const uint32_t *const resist_masks = arena.resist.data() + (slot * n);
+        const uint32_t *const single_masks = arena.singles.data() + (slot * n);
+        const uint32_t *const quad_counts = arena.quads.data() + (slot * n);
+        for (uint64_t c = 0; c < n; ++c)
+        {
+            weak[c] |= weak_masks[c];
+        }
+        for (uint64_t c = 0; c < n; ++c)
+        {
+            resist[c] |= resist_masks[c];
+        }
+        for (uint64_t c = 0; c < n; ++c)
+        {
+            quads[c] += quad_counts[c];
+        }
+        for (uint64_t c = 0; c < n; ++c)
+        {
+            shared[c] |= seen[c] & single_masks[c];
+            seen[c] |= single_masks[c];
+        }
+    }
+    uint32_t *const gyms = metrics.gyms_resisted.data();
+    for (const uint32_t gym : gym_attacks)
+    {
+        for (uint64_t c = 0; c < n; ++c)
+        {
+            gyms[c] += (gym & ~resist[c]) == 0;
+        }
+    }
+    for (uint64_t c = 0; c < n; ++c)
+    {
+        weak[c] = std::popcount(weak[c]);
+        shared[c] = std::popcount(shared[c]);
+    }
+    metrics.weakness_union = std::move(weak);
+    metrics.type_overlap = std::move(shared);
+    return metrics;
+}
+
+std::span<const uint32_t>
+metric_column(const Team_metrics &metrics, Team_metric metric)
+{
+    switch (metric)
+    {
+    case weakness_union:
+        return metrics.weakness_union;
+    case quad_weaknesses:
+        return metrics.quad_weaknesses;
+    case gyms_resisted:
+        return metrics.gyms_resisted;
+    case type_overlap:
+        return metrics.type_overlap;
+    }
+    return {};
+}
+
+void
+filter_covers(const Team_metrics &metrics, Team_metric metric, uint32_t limit,
+              std::vector<uint32_t> &out)
+{
+    const std::span<const uint32_t> column = metric_column(metrics, metric);
+    out.clear();
+    for (uint32_t c = 0; c < column.size(); ++c)
+    {
+        if (metric == gyms_resisted ? limit <= column[c] : column[c] <= limit)
+        {
+            out.push_back(c);
+        }
+    }
+}
+
+void
+sort_covers(const Team_metrics &metrics, Team_metric metric,
+            std::vector<uint32_t> &order)
+{
+    const std::span<const uint32_t> column = metric_column(metrics, metric);
+    if (order.empty())
+    {
+        order.resize(column.size());
+        for (uint32_t c = 0; c < order.size(); ++c)
+        {
+            order[c] = c;
+        }
+    }
+    if (metric == gyms_resisted)
+    {
+        std::ranges::stable_sort(order, [column](uint32_t a, uint32_t b) {
+            return column[b] < column[a];
+        });
+        return;
+    }
+    std::ranges::stable_sort(order, [column](uint32_t a, uint32_t b) {
+        return column[a] < column[b];
+    });
+}
+
+} // namespace Dancing_links
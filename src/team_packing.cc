@@ -0,0 +1,290 @@
+/// Author: Alexander Lopez File: team_packing.cc
+/// ----------------------
+/// Double battles and rotating rosters need several teams at once, each
+/// covering every live item and no two sharing a typing. Pairing the results
+/// of separate searches grows with the square of the answer so here the teams
+/// are searched together. The first team is built as usual, branching on the
+/// uncovered item with the fewest options left. Once it covers everything its
+/// options are taken and the next team starts from nothing. Teams are kept in
+/// order of their first option so a packing is never found once per ordering
+/// of its teams, and every option tried at a branch is set aside for the rest
+/// of that branch of the same team so a team is never found twice.
+module;
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+export module dancing_links:team_packing;
+import :pokemon_links;
+import :ranked_set;
+import :resistance;
+import :type_encoding;
+
+/////////////////////////////////////////   Exported Interface
+
+export namespace Dancing_links {
+
+/// @brief disjoint_coverages finds every way to build several teams that each
+/// cover the live items with no option used by more than one team. Exact
+/// teams are ranked as the links rank them. An overlapping team scores each
+/// item by the best multiplier any of its members has against it. Team rules
+/// on secondary items are not applied.
+/// @param links the links to read. Hidden items and options are respected.
+/// @param teams how many disjoint teams to build.
+/// @param choice_limit the size limit of each team.
+/// @param overlapping true if options in one team may cover the same items.
+/// @param max_output the search stops once this many packings are found.
+/// @return each packing once with its teams in order of their first option.
+std::vector<std::vector<Ranked_set<Type_encoding>>>
+disjoint_coverages(const Pokemon_links &links, int teams, int choice_limit,
+                   bool overlapping, uint64_t max_output = 200'000);
+
+} // namespace Dancing_links
+
+////////////////////////////////////////   Implementation
+
+namespace Dancing_links {
+
+namespace {
+
+struct Packing_option
+{
+    Type_encoding name;
+    std::vector<std::pair<uint64_t, Multiplier>> items;
+    std::vector<uint64_t> bits;
+};
+
+class Packing_search {
+  public:
+    Packing_search(const Pokemon_links &links, bool overlapping)
+        : overlapping_(overlapping),
+          defense_(links.get_links_type() == Pokemon_links::defense)
+    {
+        const std::vector<Pokemon_links::Poke_link> &nodes = links.links();
+        const std::vector<Pokemon_links::Type_name> &items = links.item_table();
+        const std::vector<Pokemon_links::Encoding_index> &options
+            = links.option_table();
+        std::vector<uint64_t> item_of(items.size(), UINT64_MAX);
+        for (uint64_t i = items[0].right; i != 0; i = items[i].right)
+        {
+            item_of[i] = num_items_++;
+        }
+        words_ = (num_items_ + 63) / 64;
+        columns_.resize(num_items_);
+        for (uint64_t o = 1; o < options.size(); ++o)
+        {
+            const uint64_t spacer = options[o].index;
+            if (nodes[spacer].tag == Pokemon_links::hidden)
+            {
+                continue;
+            }
+            Packing_option option{options[o].name, {},
+                                  std::vector<uint64_t>(words_, 0)};
+            for (uint64_t i = spacer + 1; nodes[i].top_or_len > 0; ++i)
+            {
+                const auto top = static_cast<uint64_t>(nodes[i].top_or_len);
+                if (nodes[i].tag == Pokemon_links::hidden
+                    || item_of[top] == UINT64_MAX)
+                {
+                    continue;
+                }
+                const uint64_t item = item_of[top];
+                option.items.emplace_back(item, nodes[i].multiplier);
+                option.bits[item / 64] |= uint64_t{1} << (item % 64);
+            }
+            if (option.items.empty())
+            {
+                continue;
+            }
+            for (const auto &[item, m] : option.items)
+            {
+                columns_[item].push_back(options_.size());
+            }
+            options_.push_back(std::move(option));
+        }
+        taken_.assign(options_.size(), false);
+    }
+
+    std::vector<std::vector<Ranked_set<Type_encoding>>>
+    run(int teams, int choice_limit, uint64_t max_output)
+    {
+        std::vector<std::vector<Ranked_set<Type_encoding>>> packings{};
+        if (teams <= 0 || choice_limit <= 0 || !num_items_)
+        {
+            return packings;
+        }
+        choice_limit_ = choice_limit;
+        max_output_ = max_output;
+        aside_.assign(teams, std::vector<bool>(options_.size(), false));
+        members_.assign(teams, {});
+        floors_.assign(teams, 0);
+        covered_.assign(words_, 0);
+        static_cast<void>(search(0, choice_limit, packings));
+        return packings;
+    }
+
+  private:
+    uint64_t num_items_{0};
+    uint64_t words_{0};
+    bool overlapping_;
+    bool defense_;
+    std::vector<Packing_option> options_{};
+    std::vector<std::vector<uint64_t>> columns_{};
+    // State of the search.
+    int choice_limit_{0};
+    uint64_t max_output_{0};
+    std::vector<bool> taken_{};              // Members of any team so far.
+    std::vector<std::vector<bool>> aside_{}; // Tried at a branch of a team.
+    std::vector<std::vector<uint64_t>> members_{};
+    std::vector<uint64_t> floors_{}; // A team only takes options at or above.
+    std::vector<uint64_t> covered_{};
+
+    [[nodiscard]] bool
+    available(uint64_t team, uint64_t o) const
+    {
+        if (taken_[o] || aside_[team][o] || o < floors_[team])
+        {
+            return false;
+        }
+        if (overlapping_)
+        {
+            return true;
+        }
+        for (uint64_t w = 0; w < words_; ++w)
+        {
+            if (options_[o].bits[w] & covered_[w])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// Returns false once the output cutoff is reached.
+    [[nodiscard]] bool
+    search(uint64_t team, int left,
+           std::vector<std::vector<Ranked_set<Type_encoding>>> &packings)
+    {
+        uint64_t item = num_items_;
+        uint64_t fewest = UINT64_MAX;
+        for (uint64_t i = 0; i < num_items_; ++i)
+        {
+            if ((covered_[i / 64] >> (i % 64)) & 1)
+            {
+                continue;
+            }
+            const auto count = static_cast<uint64_t>(std::ranges::count_if(
+                columns_[i], [&](uint64_t o) { return available(team, o); }));
+            if (count < fewest)
+            {
+                item = i;
+                fewest = count;
+            }
+        }
+        if (item == num_items_)
+        {
+            return finish_team(team, packings);
+        }
+        if (!fewest || !left)
+        {
+            return true;
+        }
+        std::vector<uint64_t> set_aside{};
+        const std::vector<uint64_t> before = covered_;
+        bool more = true;
+        for (const uint64_t o : columns_[item])
+        {
+            if (!available(team, o))
+            {
+                continue;
+            }
+            aside_[team][o] = true;
+            set_aside.push_back(o);
+            taken_[o] = true;
+            members_[team].push_back(o);
+            for (uint64_t w = 0; w < words_; ++w)
+            {
+                covered_[w] |= options_[o].bits[w];
+            }
+            more = search(team, left - 1, packings);
+            covered_ = before;
+            members_[team].pop_back();
+            taken_[o] = false;
+            if (!more)
+            {
+                break;
+            }
+        }
+        for (const uint64_t o : set_aside)
+        {
+            aside_[team][o] = false;
+        }
+        return more;
+    }
+
+    /// A covering team either completes the packing or starts the next team
+    /// above its own first option.
+    [[nodiscard]] bool
+    finish_team(uint64_t team,
+                std::vector<std::vector<Ranked_set<Type_encoding>>> &packings)
+    {
+        if (team + 1 < members_.size())
+        {
+            const std::vector<uint64_t> done = covered_;
+            floors_[team + 1] = std::ranges::min(members_[team]) + 1;
+            std::ranges::fill(covered_, 0);
+            const bool more = search(team + 1, choice_limit_, packings);
+            covered_ = done;
+            return more;
+        }
+        std::vector<Ranked_set<Type_encoding>> &packing
+            = packings.emplace_back();
+        for (const std::vector<uint64_t> &members : members_)
+        {
+            packing.push_back(rank_team(members));
+        }
+        return packings.size() < max_output_;
+    }
+
+    [[nodiscard]] Ranked_set<Type_encoding>
+    rank_team(const std::vector<uint64_t> &members) const
+    {
+        std::vector<Multiplier> best(num_items_, emp);
+        for (const uint64_t o : members)
+        {
+            for (const auto &[item, m] : options_[o].items)
+            {
+                if (best[item] == emp
+                    || (defense_ ? m < best[item] : best[item] < m))
+                {
+                    best[item] = m;
+                }
+            }
+        }
+        int rank = 0;
+        for (const Multiplier m : best)
+        {
+            rank += m;
+        }
+        std::vector<Type_encoding> names{};
+        names.reserve(members.size());
+        for (const uint64_t o : members)
+        {
+            names.push_back(options_[o].name);
+        }
+        std::ranges::sort(names);
+        return {rank, std::move(names)};
+    }
+};
+
+} // namespace
+
+std::vector<std::vector<Ranked_set<Type_encoding>>>
+disjoint_coverages(const Pokemon_links &links, int teams, int choice_limit,
+                   bool overlapping, uint64_t max_output)
+{
+    Packing_search search(links, overlapping);
+    return search.run(teams, choice_limit, max_output);
+}
+
+} // namespace Dancing_links
@@ -0,0 +1,318 @@
+/// Author: Alexander G. Lopez
+/// File: startup_bench.cc
+/// ---------------------
+/// A pokemon_cli run answers most questions in a few milliseconds so reading
+/// the type charts, the maps, and the gyms, and building the links, is most of
+/// what a user waits for. This program times every loading stage on every map
+/// and counts the heap allocations each stage makes. Run it from the root of
+/// the repository.
+///
+/// ./build/rel/tests/startup_bench
+///
+/// Each stage runs once as a first call and then repeatedly warm. The warm
+/// time is the fastest repeat. A first call is not a cold start: stages of
+/// earlier maps have already warmed the code and the heap, and the files may
+/// sit in the operating system's cache. The two type chart readers run before
+/// any other stage reads the chart and take turns going first from map to
+/// map so neither is always timed after the other. Drop the page cache before
+/// the run to see a first start from disk. Name maps or the number of warm
+/// repeats to narrow the run.
+///
+/// ./build/rel/tests/startup_bench repeats=50 data/dst/Gen-1-Kanto.dst
+import dancing_links;
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <new>
+#include <set>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace Dx = Dancing_links;
+namespace {
+
+std::atomic<uint64_t> allocations{0};
+std::atomic<uint64_t> allocated_bytes{0};
+
+} // namespace
+
+/// Every allocation in the process passes through here so a stage can be
+/// charged for what it asks of the heap.
+void *
+operator new(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (void *const memory = std::malloc(size ? size : 1))
+    {
+        return memory;
+    }
+    throw std::bad_alloc{};
+}
+
+// GCC pairs the free here with the new at each call site it is inlined into
+// and cannot see that this operator new is malloc.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void
+operator delete(void *memory) noexcept
+{
+    std::free(memory);
+}
+#pragma GCC diagnostic pop
+
+void
+operator delete(void *memory, std::size_t) noexcept
+{
+    ::operator delete(memory);
+}
+
+namespace {
+
+constexpr std::string_view all_maps_dir = "data/dst";
+
+constexpr auto help_msg =
+    R"(Startup Bench Usage:
+    h                - Read this help message.
+    data/dst/map.dst - Add a map to the run. Every map in data/dst by default.
+    repeats=[N]      - Warm runs of each stage after the first call. 20 default.
+Example Command:
+    ./build/rel/tests/startup_bench repeats=50 data/dst/Gen-2-Johto.dst)";
+
+struct Stage_result
+{
+    std::string map;
+    std::string stage;
+    std::chrono::nanoseconds first_call;
+    std::chrono::nanoseconds warm;
+    uint64_t allocations;
+    uint64_t bytes;
+};
+
+// Results of every stage land here so no stage can be optimized away.
+uint64_t sink = 0;
+
+int run(std::span<const char *const> args);
+std::vector<Stage_result> bench_map(const std::string &path, int repeats,
+                                    bool parsed_first);
+void print_results(const std::vector<Stage_result> &results);
+void help();
+
+/// Runs work once and then repeats times warm. Allocations are counted over
+/// the first call since that is the one a short program pays for.
+template <typename Work>
+Stage_result
+measure(const std::string &map, std::string_view stage, int repeats,
+        const Work &work)
+{
+    Stage_result result{map, std::string{stage}, {}, {}, 0, 0};
+    const uint64_t calls_before = allocations.load();
+    const uint64_t bytes_before = allocated_bytes.load();
+    auto start = std::chrono::steady_clock::now();
+    sink += work();
+    result.first_call = std::chrono::steady_clock::now() - start;
+    result.allocations = allocations.load() - calls_before;
+    result.bytes = allocated_bytes.load() - bytes_before;
+    result.warm = result.first_call;
+    for (int i = 0; i < repeats; ++i)
+    {
+        start = std::chrono::steady_clock::now();
+        sink += work();
+        const std::chrono::nanoseconds time
+            = std::chrono::steady_clock::now() - start;
+        result.warm = std::min(result.warm, time);
+    }
+    return result;
+}
+
+} // namespace
+
+int
+main(int argc, char **argv)
+{
+    const auto args
+        = std::span<const char *const>{argv, static_cast<size_t>(argc)}.subspan(
+            1);
+    return run(args);
+}
+
+namespace {
+
+int
+run(const std::span<const char *const> args)
+{
+    try
+    {
+        std::vector<std::string> maps{};
+        int repeats = 20;
+        for (const auto &arg : args)
+        {
+            const std::string_view arg_str{arg};
+            if (arg_str.starts_with("repeats="))
+            {
+                repeats = std::stoi(std::string(
+                    arg_str.substr(std::string_view("repeats=").size())));
+            }
+            else if (arg_str.find('/') != std::string::npos)
+            {
+                maps.emplace_back(arg_str);
+            }
+            else if (arg_str == "h")
+            {
+                help();
+                return 0;
+            }
+            else
+            {
+                std::cerr << "Unknown argument: " << arg_str << "\n";
+                help();
+                return 1;
+            }
+        }
+        if (maps.empty())
+        {
+            for (const auto &entry :
+                 std::filesystem::directory_iterator(all_maps_dir))
+            {
+                if (entry.path().extension() == ".dst")
+                {
+                    maps.push_back(entry.path().string());
+                }
+            }
+            std::ranges::sort(maps);
+        }
+        std::vector<Stage_result> results{};
+        bool parsed_first = false;
+        for (const std::string &path : maps)
+        {
+            for (Stage_result &result : bench_map(path, repeats, parsed_first))
+            {
+                results.push_back(std::move(result));
+            }
+            parsed_first = !parsed_first;
+        }
+        print_results(results);
+        return 0;
+    } catch (const std::exception &e)
+    {
+        std::cerr << "Startup bench encountered exception: " << e.what()
+                  << "\n";
+        help();
+        return 1;
+    }
+}
+
+std::vector<Stage_result>
+bench_map(const std::string &path, int repeats, bool parsed_first)
+{
+    const std::string name = path.substr(path.find_last_of('/') + 1);
+    std::vector<Stage_result> results{};
+    const auto scanned = [&] {
+        return measure(name, "load_interaction_map scanned", repeats, [&path] {
+            std::ifstream dst(path);
+            return Dx::load_interaction_map(dst, Dx::scanned_json).size();
+        });
+    };
+    const auto parsed = [&] {
+        return measure(name, "load_interaction_map parsed", repeats, [&path] {
+            std::ifstream dst(path);
+            return Dx::load_interaction_map(dst, Dx::parsed_json).size();
+        });
+    };
+    results.push_back(parsed_first ? parsed() : scanned());
+    results.push_back(parsed_first ? scanned() : parsed());
+    results.push_back(
+        measure(name, "load_pokemon_generation", repeats, [&path] {
+            std::ifstream dst(path);
+            const Dx::Pokemon_test generation
+                = Dx::load_pokemon_generation(dst);
+            return generation.interactions.size()
+                   + generation.gen_map.network.size();
+        }));
+    results.push_back(measure(name, "load_map", repeats, [&path] {
+        std::ifstream dst(path);
+        return Dx::load_map(dst).network.size();
+    }));
+
+    std::vector<std::string> gyms{};
+    for (const auto &[gym, types] : Dx::load_map_gyms(name))
+    {
+        gyms.push_back(gym);
+    }
+    for (const std::string &gym : gyms)
+    {
+        const std::set<std::string> selected{gym};
+        results.push_back(measure(
+            name, "load_selected_gyms_attacks " + gym, repeats,
+            [&name, &selected] {
+                return Dx::load_selected_gyms_attacks(name, selected).size();
+            }));
+        results.push_back(measure(
+            name, "load_selected_gyms_defenses " + gym, repeats,
+            [&name, &selected] {
+                return Dx::load_selected_gyms_defenses(name, selected).size();
+            }));
+    }
+
+    std::ifstream dst(path);
+    const std::map<Dx::Type_encoding, std::set<Dx::Resistance>> interactions
+        = Dx::load_interaction_map(dst);
+    results.push_back(
+        measure(name, "Pokemon_links defense", repeats, [&interactions] {
+            const Dx::Pokemon_links links(interactions,
+                                          Dx::Pokemon_links::defense);
+            return links.get_num_items();
+        }));
+    results.push_back(
+        measure(name, "Pokemon_links attack", repeats, [&interactions] {
+            const Dx::Pokemon_links links(interactions,
+                                          Dx::Pokemon_links::attack);
+            return links.get_num_items();
+        }));
+    return results;
+}
+
+void
+print_results(const std::vector<Stage_result> &results)
+{
+    const auto micros = [](std::chrono::nanoseconds time) {
+        return std::chrono::duration<double, std::micro>(time).count();
+    };
+    std::cout << std::left << std::setw(22) << "map" << std::setw(42)
+              << "stage" << std::right << std::setw(12) << "first us"
+              << std::setw(12) << "warm us" << std::setw(10) << "allocs"
+              << std::setw(12) << "bytes"
+              << "\n";
+    std::cout << std::fixed << std::setprecision(1);
+    for (const Stage_result &result : results)
+    {
+        std::cout << std::left << std::setw(22) << result.map << std::setw(42)
+                  << result.stage << std::right << std::setw(12)
+                  << micros(result.first_call) << std::setw(12)
+                  << micros(result.warm) << std::setw(10)
+                  << result.allocations << std::setw(12) << result.bytes
+                  << "\n";
+    }
+    // Printing the sink keeps every stage's work observable.
+    std::cout << "Checksum " << sink << "\n";
+}
+
+void
+help()
+{
+    std::cout << help_msg << "\n";
+}
+
+} // namespace
@@ -29,18 +29,28 @@
 /// learn a lot about how Dancing Links works by reading these tests.
 import dancing_links;
 
+#include "dancing_links_c.h"
+
 #include <gtest/gtest.h>
 
 #include <algorithm>
+#include <array>
 #include <bit>
+#include <chrono>
 #include <cstdint>
 #include <ctime>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <optional>
 #include <random>
 #include <set>
+#include <sstream>
 #include <span>
+#include <stdexcept>
+#include <stop_token>
+#include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
@@ -2908,4 +2918,1646 @@ TEST(InternalTests, TestHidingAllOptionsAndItemsExactThenOverlappingSolution)
     EXPECT_EQ(links.get_num_hid_options(), 0);
 }
 
+//////////////////////////////////    Shared Generation Maps
+
+namespace {
+
+using Interactions = std::map<Type_encoding, std::set<Resistance>>;
+
+/// Many tests below search full generations. Each map is read from disk the
+/// first time a test asks for it and every later test shares that copy. A
+/// map that will not open is never kept, and the throw ends only the test
+/// that asked for it as a failure.
+const Interactions &
+generation_interactions(const std::string &path)
+{
+    static std::map<std::string, Interactions> loaded{};
+    auto found = loaded.find(path);
+    if (found == loaded.end())
+    {
+        std::ifstream map(path);
+        if (!map.is_open())
+        {
+            throw std::runtime_error("Could not open map file " + path);
+        }
+        found = loaded.emplace(path, load_interaction_map(map)).first;
+    }
+    return found->second;
+}
+
+} // namespace
+
+//////////////////////////////////    Grouped Solutions by Cover Size
+
+TEST(InternalTests, GroupedCoversMatchUngroupedCoversBySize)
+{
+    /// A trimmed version of the nonsense attack data in the recursive and
+    /// iterative equivalence test. Only the super effective entries matter.
+    const std::map<Type_encoding, std::set<Resistance>> types = {
+        {{"Bug-Ghost"}, {{{"Fire"}, db}, {{"Normal"}, im}, {{"Rock"}, db}}},
+        {{"Electric-Grass"},
+         {{{"Fire"}, db}, {{"Ice"}, db}, {{"Psychic"}, db}}},
+        {{"Fire-Flying"},
+         {{{"Electric"}, db}, {{"Water"}, db}, {{"Psychic"}, db}}},
+        {{"Ground-Water"}, {{{"Grass"}, qd}, {{"Bug"}, db}}},
+        {{"Ice-Psychic"}, {{{"Fire"}, db}, {{"Fighting"}, db}, {{"Rock"}, db}}},
+        {{"Ice-Water"},
+         {{{"Electric"}, db},
+          {{"Grass"}, db},
+          {{"Fighting"}, db},
+          {{"Steel"}, db}}},
+    };
+    Pokemon_links links(types, Pokemon_links::attack);
+    const std::set<Ranked_set<Type_encoding>> all
+        = links.exact_coverages_stack(24);
+    const std::vector<std::set<Ranked_set<Type_encoding>>> groups
+        = links.exact_coverages_grouped(24);
+    const std::vector<uint64_t> counts = links.exact_coverage_counts(24);
+    ASSERT_EQ(groups.size(), 25);
+    ASSERT_EQ(counts.size(), 25);
+    std::set<Ranked_set<Type_encoding>> merged{};
+    for (uint64_t size = 0; size < groups.size(); ++size)
+    {
+        EXPECT_EQ(groups[size].size(), counts[size]);
+        for (const auto &cover : groups[size])
+        {
+            EXPECT_EQ(cover.size(), size);
+            merged.insert(cover);
+        }
+    }
+    EXPECT_EQ(merged, all);
+    EXPECT_EQ(all.empty(), false);
+    EXPECT_EQ(links.overlapping_coverages_grouped(3)[3].size() >= counts[3],
+              true);
+}
+
+TEST(InternalTests, GroupedOverlappingCoversOnAFullGeneration)
+{
+    const Interactions &interactions
+        = generation_interactions("data/dst/Gen-2-Johto.dst");
+    Pokemon_links links(interactions, Pokemon_links::defense);
+    const std::set<Ranked_set<Type_encoding>> all
+        = links.overlapping_coverages_stack(6);
+    const std::vector<std::set<Ranked_set<Type_encoding>>> groups
+        = links.overlapping_coverages_grouped(6);
+    uint64_t total = 0;
+    for (const auto &group : groups)
+    {
+        total += group.size();
+    }
+    EXPECT_EQ(total, all.size());
+    EXPECT_EQ(groups[0].empty(), true);
+}
+
+TEST(InternalTests, TeamRulesMatchFilteredCovers)
+{
+    const Interactions &interactions
+        = generation_interactions("data/dst/Gen-2-Johto.dst");
+    const Type_encoding ground("Ground");
+    const auto multiplier_of = [&](Type_encoding typing, Type_encoding attack) {
+        const auto &resistances = interactions.at(typing);
+        const auto found = resistances.find({attack, em});
+        return found == resistances.end() ? nm : found->multiplier();
+    };
+    const auto obeys = [&](const Ranked_set<Type_encoding> &team) {
+        std::set<uint64_t> singles{};
+        uint64_t total_types = 0;
+        uint64_t weak = 0;
+        for (const Type_encoding &t : team)
+        {
+            const auto [first, second] = t.decode_indices();
+            singles.insert(first);
+            ++total_types;
+            if (second)
+            {
+                singles.insert(second.value());
+                ++total_types;
+            }
+            weak += nm < multiplier_of(t, ground);
+            for (const Resistance &r : interactions.at(t))
+            {
+                if (r.multiplier() == qd)
+                {
+                    return false;
+                }
+            }
+        }
+        return singles.size() == total_types && weak <= 1;
+    };
+    const std::vector<Pokemon_links::Team_rule> rules = {
+        {Pokemon_links::distinct_types},
+        {Pokemon_links::one_weak_to, ground},
+        {Pokemon_links::no_quad_weakness},
+    };
+
+    Pokemon_links unconstrained(interactions, Pokemon_links::defense);
+    std::set<Ranked_set<Type_encoding>> expected_exact{};
+    for (const auto &cover : unconstrained.exact_coverages_stack(6))
+    {
+        if (obeys(cover))
+        {
+            expected_exact.insert(cover);
+        }
+    }
+
+    Pokemon_links ruled(interactions, rules);
+    EXPECT_EQ(ruled.get_items(), unconstrained.get_items());
+    EXPECT_EQ(ruled.exact_coverages_stack(6), expected_exact);
+    // Overlapping results depend on search order so only check the rules.
+    const std::set<Ranked_set<Type_encoding>> overlapping
+        = ruled.overlapping_coverages_stack(6);
+    EXPECT_EQ(overlapping.empty(), false);
+    for (const auto &cover : overlapping)
+    {
+        EXPECT_EQ(obeys(cover), true);
+    }
+}
+
+TEST(InternalTests, SameWeaknessRuleUsesColors)
+{
+    const Interactions &interactions
+        = generation_interactions("data/dst/Gen-2-Johto.dst");
+    const Type_encoding ice("Ice");
+    const auto ice_multiplier = [&](Type_encoding typing) {
+        const auto &resistances = interactions.at(typing);
+        const auto found = resistances.find({ice, em});
+        return found == resistances.end() ? nm : found->multiplier();
+    };
+    const auto obeys = [&](const Ranked_set<Type_encoding> &team) {
+        std::set<Multiplier> weaknesses{};
+        for (const Type_encoding &t : team)
+        {
+            if (nm < ice_multiplier(t))
+            {
+                weaknesses.insert(ice_multiplier(t));
+            }
+        }
+        return weaknesses.size() <= 1;
+    };
+    Pokemon_links unconstrained(interactions, Pokemon_links::defense);
+    std::set<Ranked_set<Type_encoding>> expected{};
+    for (const auto &cover : unconstrained.exact_coverages_stack(6))
+    {
+        if (obeys(cover))
+        {
+            expected.insert(cover);
+        }
+    }
+    Pokemon_links ruled(interactions,
+                        {{Pokemon_links::same_weakness_to, ice}});
+    EXPECT_EQ(ruled.exact_coverages_stack(6), expected);
+    const std::set<Ranked_set<Type_encoding>> result
+        = ruled.overlapping_coverages_stack(5);
+    EXPECT_EQ(result.empty(), false);
+    for (const auto &cover : result)
+    {
+        EXPECT_EQ(obeys(cover), true);
+    }
+    // Search must leave every secondary color and link as it found them.
+    EXPECT_EQ(ruled.overlapping_coverages_stack(5), result);
+}
+
+TEST(InternalTests, ThresholdLinksMatchFixedLinksAtDefaultCutoff)
+{
+    const Interactions &interactions
+        = generation_interactions("data/dst/Gen-2-Johto.dst");
+    Pokemon_links fixed_defense(interactions, Pokemon_links::defense);
+    Pokemon_links tagged_defense(interactions, Pokemon_links::defense, f2);
+    EXPECT_EQ(threshold(tagged_defense), f2);
+    EXPECT_EQ(threshold(fixed_defense), f2);
+    EXPECT_EQ(tagged_defense.exact_coverages_stack(6),
+              fixed_defense.exact_coverages_stack(6));
+    EXPECT_EQ(tagged_defense.overlapping_coverages_stack(6),
+              fixed_defense.overlapping_coverages_stack(6));
+
+    Pokemon_links fixed_attack(interactions, Pokemon_links::attack);
+    Pokemon_links tagged_attack(interactions, Pokemon_links::attack, db);
+    EXPECT_EQ(tagged_attack.exact_coverages_stack(24),
+              fixed_attack.exact_coverages_stack(24));
+    EXPECT_EQ(set_threshold(fixed_attack, qd), false);
+}
+
+TEST(InternalTests, ThresholdChangesOnlyMoveNodesAndRestoreCleanly)
+{
+    const Interactions &interactions
+        = generation_interactions("data/dst/Gen-2-Johto.dst");
+    Pokemon_links links(interactions, Pokemon_links::defense, f2);
+    const std::vector<Pokemon_links::Poke_link> original = links.links();
+    const std::set<Ranked_set<Type_encoding>> original_covers
+        = links.overlapping_coverages_stack(6);
+
+    // Neutral damage counts as cover so many more teams are possible.
+    EXPECT_EQ(set_threshold(links, nm), true);
+    const std::set<Ranked_set<Type_encoding>> neutral
+        = links.overlapping_coverages_stack(2);
+    EXPECT_EQ(neutral.empty(), false);
+
+    // Only immunities and quarter resistances. Every item covered by a team
+    // must come from one of those two multipliers.
+    EXPECT_EQ(set_threshold(links, f4), true);
+    for (const auto &cover : links.exact_coverages_stack(6))
+    {
+        std::set<Type_encoding> resisted{};
+        for (const Type_encoding &t : cover)
+        {
+            for (const Resistance &r : interactions.at(t))
+            {
+                if (r.multiplier() <= f4)
+                {
+                    EXPECT_EQ(resisted.insert(r.type()).second, true);
+                }
+            }
+        }
+        EXPECT_EQ(resisted.size(), links.get_num_items());
+    }
+
+    // A different path to the same threshold agrees with a fresh build.
+    Pokemon_links fresh(interactions, Pokemon_links::defense, f4);
+    EXPECT_EQ(links.exact_coverages_stack(6), fresh.exact_coverages_stack(6));
+
+    // Options hidden by the user survive threshold changes.
+    EXPECT_EQ(hide_option(links, {"Ghost"}), true);
+    EXPECT_EQ(set_threshold(links, nm), true);
+    EXPECT_EQ(has_option(links, {"Ghost"}), false);
+    EXPECT_EQ(hide_option(fresh, {"Ghost"}), true);
+    EXPECT_EQ(set_threshold(fresh, nm), true);
+    EXPECT_EQ(links.overlapping_coverages_stack(2),
+              fresh.overlapping_coverages_stack(2));
+    reset_options(links);
+
+    EXPECT_EQ(set_threshold(links, f2), true);
+    EXPECT_EQ(links.overlapping_coverages_stack(6), original_covers);
+    const std::vector<Pokemon_links::Poke_link> &restored = links.links();
+    ASSERT_EQ(restored.size(), original.size());
+    for (uint64_t i = 0; i < restored.size(); ++i)
+    {
+        EXPECT_EQ(restored[i].top_or_len, original[i].top_or_len);
+        EXPECT_EQ(restored[i].up, original[i].up);
+        EXPECT_EQ(restored[i].down, original[i].down);
+        EXPECT_EQ(restored[i].tag, original[i].tag);
+    }
+}
+
+TEST(InternalTests, LiveMasksOnlyTouchTheDifference)
+{
+    const Interactions &interactions
+        = generation_interactions("data/dst/Gen-2-Johto.dst");
+    Pokemon_links links(interactions, Pokemon_links::defense);
+    const std::vector<Type_encoding> items = links.get_items();
+    const std::vector<Type_encoding> options = links.get_options();
+    EXPECT_EQ(set_live_items(links, std::vector<bool>(items.size() + 1)),
+              false);
+
+    std::mt19937 gen(7);
+    std::bernoulli_distribution coin(0.75);
+    for (int trial = 0; trial < 40; ++trial)
+    {
+        std::vector<bool> live_items(items.size());
+        std::set<Type_encoding> keep_items{};
+        for (uint64_t i = 0; i < items.size(); ++i)
+        {
+            live_items[i] = coin(gen);
+            if (live_items[i])
+            {
+                keep_items.insert(items[i]);
+            }
+        }
+        std::vector<bool> live_options(options.size());
+        std::set<Type_encoding> keep_options{};
+        for (uint64_t i = 0; i < options.size(); ++i)
+        {
+            live_options[i] = coin(gen);
+            if (live_options[i])
+            {
+                keep_options.insert(options[i]);
+            }
+        }
+        const std::vector<Type_encoding> before = hid_options(links);
+        ASSERT_EQ(set_live_items(links, live_items), true);
+        ASSERT_EQ(set_live_options(links, live_options), true);
+
+        // Whatever stays hidden at the bottom of the stack is never touched.
+        const std::vector<Type_encoding> after = hid_options(links);
+        for (uint64_t i = 0; i < before.size(); ++i)
+        {
+            if (keep_options.contains(before[i]))
+            {
+                break;
+            }
+            ASSERT_EQ(after.size() > i, true);
+            EXPECT_EQ(after[i], before[i]);
+        }
+
+        Pokemon_links fresh(interactions, Pokemon_links::defense);
+        hide_items_except(fresh, keep_items);
+        hide_options_except(fresh, keep_options);
+        EXPECT_EQ(links.get_items(), fresh.get_items());
+        EXPECT_EQ(links.get_options(), fresh.get_options());
+        EXPECT_EQ(links.exact_coverages_stack(6),
+                  fresh.exact_coverages_stack(6));
+    }
+    reset_all(links);
+    EXPECT_EQ(links.links(),
+              Pokemon_links(interactions, Pokemon_links::defense).links());
+}
+
+TEST(InternalTests, ForkedLinksResetToTheSharedTemplate)
+{
+    const Interactions &interactions
+        = generation_interactions("data/dst/Gen-2-Johto.dst");
+    const std::shared_ptr<const Links_template> shared
+        = make_links_template(interactions, Pokemon_links::defense);
+    const std::set<Ranked_set<Type_encoding>> expected
+        = Pokemon_links(interactions, Pokemon_links::defense)
+              .overlapping_coverages_stack(4);
+
+    Pokemon_links working = shared->fork();
+    EXPECT_EQ(hide_item(working, {"Fire"}), true);
+    EXPECT_EQ(hide_option(working, {"Ghost"}), true);
+    EXPECT_EQ(expected.empty(), false);
+    EXPECT_EQ(working.overlapping_coverages_stack(4) == expected, false);
+    shared->fork_into(working);
+    EXPECT_EQ(working.links(), shared->pristine().links());
+    EXPECT_EQ(working.item_table(), shared->pristine().item_table());
+    EXPECT_EQ(hid_items_empty(working), true);
+    EXPECT_EQ(hid_options_empty(working), true);
+    EXPECT_EQ(working.overlapping_coverages_stack(4), expected);
+
+    std::vector<std::set<Ranked_set<Type_encoding>>> results(4);
+    std::vector<std::thread> threads{};
+    for (uint64_t t = 0; t < results.size(); ++t)
+    {
+        threads.emplace_back([&shared, &results, t] {
+            Pokemon_links local = shared->fork();
+            for (int query = 0; query < 3; ++query)
+            {
+                shared->fork_into(local);
+                static_cast<void>(hide_item(local, {"Water"}));
+                static_cast<void>(local.overlapping_coverages_stack(4));
+            }
+            shared->fork_into(local);
+            results[t] = local.overlapping_coverages_stack(4);
+        });
+    }
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+    for (const auto &result : results)
+    {
+        EXPECT_EQ(result, expected);
+    }
+}
+
+TEST(InternalTests, SweepMatchesOneQueryAtATime)
+{
+    const std::vector<Sweep_map> maps = {
+        load_sweep_map("data/dst/Gen-1-Kanto.dst"),
+        load_sweep_map("data/dst/Gen-2-Johto.dst"),
+    };
+    ASSERT_EQ(maps[0].gyms.empty(), false);
+    std::vector<Sweep_query> queries = gray_code_queries(
+        maps, {Pokemon_links::defense, Pokemon_links::attack}, {false});
+    // Neighbouring gym selections differ by exactly one gym.
+    for (uint64_t i = 2; i < (uint64_t{1} << maps[0].gyms.size()); ++i)
+    {
+        EXPECT_EQ(std::popcount(queries[i].gyms ^ queries[i - 1].gyms), 1);
+    }
+    // Keep the whole generation questions and a handful of selections.
+    std::erase_if(queries, [](const Sweep_query &q) {
+        return q.gyms && (q.gyms % 37 != 1 || q.type == Pokemon_links::attack);
+    });
+    const std::vector<Sweep_result> results = run_sweep(maps, queries, 3);
+    ASSERT_EQ(results.size(), queries.size());
+    for (const Sweep_result &r : results)
+    {
+        const Sweep_map &map = maps[r.query.map];
+        Pokemon_links links(map.interactions, r.query.type);
+        std::set<std::string> selected{};
+        for (uint64_t gym = 0; gym < map.gyms.size(); ++gym)
+        {
+            if (r.query.gyms & (uint64_t{1} << gym))
+            {
+                selected.insert(map.gyms[gym]);
+            }
+        }
+        if (!selected.empty())
+        {
+            hide_items_except(
+                links, r.query.type == Pokemon_links::defense
+                           ? load_selected_gyms_attacks(map.name, selected)
+                           : load_selected_gyms_defenses(map.name, selected));
+        }
+        const int depth = r.query.type == Pokemon_links::defense ? 6 : 24;
+        EXPECT_EQ(r.covers, exact_cover_stack(links, depth).size());
+    }
+    EXPECT_THROW(static_cast<void>(load_sweep_map("data/dst/Missing.dst")),
+                 std::runtime_error);
+    Sweep_map crowded = maps[0];
+    crowded.gyms.resize(64, "Gym");
+    EXPECT_THROW(static_cast<void>(gray_code_queries(
+                     {crowded}, {Pokemon_links::defense}, {false})),
+                 std::length_error);
+}
+
+TEST(InternalTests, StreamedCoversMatchCollectedCovers)
+{
+    const Interactions &interactions
+        = generation_interactions("data/dst/Gen-2-Johto.dst");
+    Pokemon_links links(interactions, Pokemon_links::attack);
+    std::set<Ranked_set<Type_encoding>> streamed{};
+    const uint64_t found = exact_cover_streamed(
+        links, 24, [&streamed](const Ranked_set<Type_encoding> &cover) {
+            EXPECT_EQ(streamed.insert(cover).second, true);
+            return true;
+        });
+    EXPECT_EQ(found, streamed.size());
+    EXPECT_EQ(streamed, links.exact_coverages_stack(24));
+
+    Pokemon_links defense(interactions, Pokemon_links::defense);
+    std::set<Ranked_set<Type_encoding>> loose{};
+    static_cast<void>(overlapping_cover_streamed(
+        defense, 5, [&loose](const Ranked_set<Type_encoding> &cover) {
+            EXPECT_EQ(loose.insert(cover).second, true);
+            return true;
+        }));
+    EXPECT_EQ(loose, defense.overlapping_coverages_stack(5));
+
+    // Stopping early leaves the links ready for the next search.
+    uint64_t seen = 0;
+    static_cast<void>(overlapping_cover_streamed(
+        defense, 5,
+        [&seen](const Ranked_set<Type_encoding> &) { return ++seen < 3; }));
+    EXPECT_EQ(seen, 3);
+    EXPECT_EQ(loose, defense.overlapping_coverages_stack(5));
+}
+
+TEST(InternalTests, StoppedSearchesUnwindAndReportWhy)
+{
+    const Interactions &interactions
+        = generation_interactions("data/dst/Gen-9-Paldea.dst");
+    Pokemon_links links(interactions, Pokemon_links::defense);
+    const std::vector<Pokemon_links::Poke_link> original = links.links();
+    const std::vector<Pokemon_links::Type_name> items = links.item_table();
+
+    std::stop_source source{};
+    set_stop_token(links, source.get_token());
+    source.request_stop();
+    static_cast<void>(links.overlapping_coverages_stack(6));
+    EXPECT_EQ(search_status(links), Pokemon_links::cancelled);
+    EXPECT_EQ(links.links(), original);
+    EXPECT_EQ(links.item_table(), items);
+    static_cast<void>(links.overlapping_coverages_functional(6));
+    EXPECT_EQ(search_status(links), Pokemon_links::cancelled);
+    EXPECT_EQ(links.links(), original);
+    static_cast<void>(links.exact_coverages_functional(6));
+    EXPECT_EQ(links.links(), original);
+
+    clear_stop_conditions(links);
+    set_deadline(links, std::chrono::steady_clock::now());
+    const std::set<Ranked_set<Type_encoding>> partial
+        = links.overlapping_coverages_stack(6);
+    EXPECT_EQ(search_status(links), Pokemon_links::timed_out);
+    EXPECT_EQ(partial.size() < 200'000, true);
+    EXPECT_EQ(links.links(), original);
+    EXPECT_EQ(links.item_table(), items);
+
+    clear_stop_conditions(links);
+    const std::set<Ranked_set<Type_encoding>> exact
+        = links.exact_coverages_stack(6);
+    EXPECT_EQ(search_status(links), Pokemon_links::complete);
+    EXPECT_EQ(exact, links.exact_coverages_functional(6));
+    static_cast<void>(links.overlapping_coverages_stack(6));
+    EXPECT_EQ(search_status(links), Pokemon_links::output_limit);
+}
+
+TEST(InternalTests, PortfolioConfigsAgreeOnTheCovers)
+{
+    const Interactions &interactions
+        = generation_interactions("data/dst/Gen-8-Galar.dst");
+    Pokemon_links defense(interactions, Pokemon_links::defense);
+    const std::vector<Pokemon_links::Poke_link> original = defense.links();
+    const std::set<Ranked_set<Type_encoding>> exact
+        = defense.exact_coverages_stack(6);
+
+    // Item choice and option order change the path, never the exact answers.
+    for (const Portfolio_config &config : default_portfolio())
+    {
+        Pokemon_links local = defense;
+        set_item_heuristic(local, config.heuristic);
+        set_column_order(local, config.order);
+        EXPECT_EQ(local.exact_coverages_stack(6), exact);
+        EXPECT_EQ(local.exact_coverages_functional(6), exact);
+        set_column_order(local, Pokemon_links::built_order);
+        EXPECT_EQ(local.links(), original);
+    }
+
+    const Portfolio_result first
+        = portfolio_first_cover(defense, false, 6, default_portfolio());
+    ASSERT_EQ(first.covers.size(), 1U);
+    EXPECT_EQ(exact.contains(first.covers.front()), true);
+
+    const Portfolio_result best
+        = portfolio_best_covers(defense, false, 6, 3, default_portfolio());
+    EXPECT_EQ(best.status, Pokemon_links::complete);
+    ASSERT_EQ(best.covers.size(), std::min<uint64_t>(3, exact.size()));
+    const int best_rank
+        = std::ranges::min(exact, {}, [](const auto &c) { return c.rank(); })
+              .rank();
+    EXPECT_EQ(best.covers.front().rank(), best_rank);
+    EXPECT_EQ(defense.links(), original);
+}
+
+TEST(InternalTests, ParetoSearchKeepsOnlyUnbeatenTeams)
+{
+    const std::vector<Pokemon_links::Objective> objectives{
+        Pokemon_links::team_size, Pokemon_links::total_score,
+        Pokemon_links::shared_weaknesses, Pokemon_links::quad_weaknesses};
+    // Score every cover the plain search finds by brute force and keep those
+    // that nothing beats.
+    const auto front
+        = [&objectives](
+              const std::map<Type_encoding, std::set<Resistance>> &types,
+              const std::set<Ranked_set<Type_encoding>> &covers) {
+              std::vector<Pokemon_links::Pareto_cover> scored{};
+              for (const Ranked_set<Type_encoding> &cover : covers)
+              {
+                  std::map<Type_encoding, int> weak{};
+                  int quads = 0;
+                  for (const Type_encoding &member : cover)
+                  {
+                      for (const Resistance &r : types.at(member))
+                      {
+                          weak[r.type()] += nm < r.multiplier();
+                          quads += r.multiplier() == qd;
+                      }
+                  }
+                  const int shared = static_cast<int>(std::ranges::count_if(
+                      weak, [](const auto &w) { return w.second >= 2; }));
+                  scored.push_back({cover,
+                                    {static_cast<int>(cover.size()),
+                                     cover.rank(), shared, quads}});
+              }
+              std::vector<Pokemon_links::Pareto_cover> result{};
+              for (const auto &a : scored)
+              {
+                  if (std::ranges::none_of(scored, [&a](const auto &b) {
+                          return std::ranges::equal(
+                                     b.scores, a.scores,
+                                     std::less_equal{})
+                                 && b.scores != a.scores;
+                      }))
+                  {
+                      result.push_back(a);
+                  }
+              }
+              std::ranges::sort(result, [](const auto &a, const auto &b) {
+                  return a.scores != b.scores ? a.scores < b.scores
+                                              : a.cover < b.cover;
+              });
+              return result;
+          };
+
+    const Interactions &galar_types
+        = generation_interactions("data/dst/Gen-8-Galar.dst");
+    Pokemon_links exact(galar_types, Pokemon_links::defense);
+    const std::vector<Pokemon_links::Poke_link> original = exact.links();
+    const std::vector<Pokemon_links::Pareto_cover> exact_front
+        = exact_pareto_cover(exact, 6, objectives);
+    EXPECT_EQ(exact_front.empty(), false);
+    EXPECT_EQ(exact_front, front(galar_types, exact.exact_coverages_stack(6)));
+    EXPECT_EQ(exact.links(), original);
+
+    const Interactions &johto_types
+        = generation_interactions("data/dst/Gen-2-Johto.dst");
+    Pokemon_links loose(johto_types, Pokemon_links::defense);
+    const std::vector<Pokemon_links::Pareto_cover> loose_front
+        = overlapping_pareto_cover(loose, 4, objectives);
+    EXPECT_EQ(loose_front.empty(), false);
+    EXPECT_EQ(loose_front,
+              front(johto_types, loose.overlapping_coverages_stack(4)));
+
+    // Fewer objectives can only shrink the front to the best of what is left.
+    const std::vector<Pokemon_links::Pareto_cover> smallest
+        = overlapping_pareto_cover(loose, 4, {Pokemon_links::team_size});
+    ASSERT_EQ(smallest.empty(), false);
+    for (const Pokemon_links::Pareto_cover &p : smallest)
+    {
+        EXPECT_EQ(p.scores.front(), loose_front.front().scores.front());
+    }
+}
+
+TEST(InternalTests, SpeciesRowsCollapseAndExpandToNames)
+{
+    const Interactions &interactions
+        = generation_interactions("data/dst/Gen-9-Paldea.dst");
+
+    // One plain species per typing is the typing problem under new names.
+    std::vector<Species> one_each{};
+    for (const auto &[type, resistances] : interactions)
+    {
+        one_each.push_back({type.to_string(), type, {}});
+    }
+    Pokemon_links typings(interactions, Pokemon_links::defense);
+    Pokemon_links by_species(interactions, one_each);
+    EXPECT_EQ(by_species.get_num_options(), typings.get_num_options());
+    std::set<Ranked_set<Type_encoding>> named{};
+    for (const Ranked_set<uint64_t> &cover : exact_species_cover(by_species, 6))
+    {
+        std::vector<Type_encoding> types{};
+        for (const uint64_t option : cover)
+        {
+            types.push_back(by_species.option_table()[option].name);
+            EXPECT_EQ(option_species(by_species, option).front(),
+                      types.back().to_string());
+        }
+        named.insert({cover.rank(), std::move(types)});
+    }
+    EXPECT_EQ(named, typings.exact_coverages_stack(6));
+
+    const std::vector<Species> sample
+        = load_species("data/json/species-sample.json");
+    ASSERT_EQ(sample.size(), 37U);
+    Pokemon_links species(interactions, sample);
+    // Flash Fire, plain Electric, Flying-Steel, and Water immune Water-Ground
+    // species all collapse.
+    EXPECT_EQ(species.get_num_options(), 32U);
+    bool found_fire = false;
+    for (uint64_t option = 1; option <= species.get_num_options(); ++option)
+    {
+        if (option_species(species, option)
+            == std::vector<std::string>{"Arcanine", "Flareon", "Ninetales"})
+        {
+            found_fire = true;
+        }
+    }
+    EXPECT_EQ(found_fire, true);
+
+    const std::set<Ranked_set<uint64_t>> covers
+        = overlapping_species_cover(species, 6);
+    ASSERT_EQ(covers.empty(), false);
+    for (const Ranked_set<uint64_t> &cover : covers)
+    {
+        std::set<Type_encoding> typings_used{};
+        uint64_t product = 1;
+        for (const uint64_t option : cover)
+        {
+            EXPECT_EQ(
+                typings_used.insert(species.option_table()[option].name).second,
+                true);
+            product *= option_species(species, option).size();
+        }
+        uint64_t seen = 0;
+        const uint64_t teams = for_each_species_team(
+            species, cover,
+            [&seen, &cover](const std::vector<std::string_view> &t) {
+                EXPECT_EQ(t.size(), cover.size());
+                ++seen;
+                return true;
+            });
+        EXPECT_EQ(teams, product);
+        EXPECT_EQ(seen, product);
+    }
+
+    // Hiding a typing by name hides every species row of that typing.
+    uint64_t shared_row = 0;
+    for (uint64_t option = 2; option <= species.get_num_options(); ++option)
+    {
+        if (species.option_table()[option].name
+            == species.option_table()[option - 1].name)
+        {
+            shared_row = option;
+            break;
+        }
+    }
+    ASSERT_NE(shared_row, 0U);
+    const Type_encoding shared = species.option_table()[shared_row].name;
+    const auto rows = static_cast<uint64_t>(std::ranges::count_if(
+        species.option_table(),
+        [shared](const Pokemon_links::Encoding_index &entry) {
+            return entry.name == shared;
+        }));
+    EXPECT_EQ(rows >= 2, true);
+    EXPECT_EQ(has_option(species, shared), true);
+    EXPECT_EQ(hide_option(species, shared), true);
+    EXPECT_EQ(has_option(species, shared), false);
+    EXPECT_EQ(hide_option(species, shared), false);
+    EXPECT_EQ(species.get_num_options(), 32U - rows);
+    EXPECT_EQ(species.get_num_hid_options(), rows);
+    for (const Ranked_set<uint64_t> &cover :
+         overlapping_species_cover(species, 6))
+    {
+        for (const uint64_t option : cover)
+        {
+            EXPECT_NE(species.option_table()[option].name, shared);
+        }
+    }
+    species.reset_options();
+    EXPECT_EQ(has_option(species, shared), true);
+    EXPECT_EQ(species.get_num_options(), 32U);
+}
+
+TEST(InternalTests, AnytimeCoversRespectHiddenItemsAndOptions)
+{
+    const Interactions &interactions
+        = generation_interactions("data/dst/Gen-9-Paldea.dst");
+    Pokemon_links defense(interactions, Pokemon_links::defense);
+    const auto resists = [&interactions](
+                             const Ranked_set<Type_encoding> &team,
+                             const std::vector<Type_encoding> &items) {
+        return std::ranges::all_of(items, [&](Type_encoding attack) {
+            return std::ranges::any_of(team, [&](Type_encoding member) {
+                const auto found = interactions.at(member).find({attack, em});
+                return found->multiplier() < nm;
+            });
+        });
+    };
+
+    std::vector<int> ranks{};
+    const Anytime_result first = anytime_cover(
+        defense, 6, std::chrono::milliseconds(50),
+        [&ranks](const Ranked_set<Type_encoding> &cover) {
+            ranks.push_back(cover.rank());
+            return true;
+        });
+    ASSERT_EQ(first.best.empty(), false);
+    EXPECT_EQ(first.best.size() <= 6, true);
+    EXPECT_EQ(resists(first.best, defense.get_items()), true);
+    EXPECT_EQ(first.improvements, ranks.size());
+    EXPECT_EQ(std::ranges::is_sorted(ranks, std::greater{}), true);
+    EXPECT_EQ(ranks.back(), first.best.rank());
+
+    // Whatever the caller hides stays hidden.
+    const Type_encoding banned = *first.best.begin();
+    ASSERT_EQ(defense.hide_requested_option(banned), true);
+    ASSERT_EQ(defense.hide_requested_item(Type_encoding("Fire")), true);
+    const std::vector<Pokemon_links::Poke_link> before = defense.links();
+    const Anytime_result second
+        = anytime_cover(defense, 6, std::chrono::milliseconds(50));
+    ASSERT_EQ(second.best.empty(), false);
+    EXPECT_EQ(std::ranges::find(second.best, banned) == second.best.end(),
+              true);
+    EXPECT_EQ(resists(second.best, defense.get_items()), true);
+    EXPECT_EQ(defense.links(), before);
+
+    // Stopping from the callback ends the search at the first cover.
+    const Anytime_result stopped = anytime_cover(
+        defense, 6, std::chrono::seconds(10),
+        [](const Ranked_set<Type_encoding> &) { return false; });
+    EXPECT_EQ(stopped.improvements, 1U);
+
+    // Options that agree on the color of a rule may share its item.
+    const Interactions &galar
+        = generation_interactions("data/dst/Gen-8-Galar.dst");
+    const Type_encoding ground("Ground");
+    Pokemon_links ruled(galar, {{Pokemon_links::same_weakness_to, ground}});
+    const auto weak_to_ground = [&galar, ground](
+                                    const Ranked_set<Type_encoding> &team) {
+        return std::ranges::count_if(team, [&galar, ground](Type_encoding t) {
+            return nm < galar.at(t).find({ground, em})->multiplier();
+        });
+    };
+    const std::set<Ranked_set<Type_encoding>> ruled_covers
+        = ruled.exact_coverages_stack(6);
+    const auto shared = std::ranges::find_if(
+        ruled_covers, [&](const Ranked_set<Type_encoding> &cover) {
+            return weak_to_ground(cover) >= 2;
+        });
+    ASSERT_NE(shared, ruled_covers.end());
+    ruled.hide_all_options_except({shared->begin(), shared->end()});
+    const Anytime_result agreeing
+        = anytime_cover(ruled, 6, std::chrono::milliseconds(50));
+    EXPECT_EQ(std::ranges::equal(agreeing.best, *shared), true);
+}
+
+TEST(InternalTests, TeamAnalysisKernelsMatchMapLookups)
+{
+    const Interactions &interactions
+        = generation_interactions("data/dst/Gen-2-Johto.dst");
+    Pokemon_links defense(interactions, Pokemon_links::defense);
+    const std::set<Ranked_set<Type_encoding>> covers
+        = defense.overlapping_coverages_stack(4);
+    ASSERT_EQ(covers.empty(), false);
+
+    const Dense_chart chart(interactions);
+    EXPECT_EQ(chart.typing_index(Type_encoding("Fairy")), chart.num_typings());
+    std::vector<uint32_t> gyms{};
+    std::vector<std::set<Type_encoding>> gym_sets{};
+    for (const auto &[name, types] : load_map_gyms("Gen-2-Johto.dst"))
+    {
+        gyms.push_back(chart.attack_mask(types.attack));
+        gym_sets.push_back(types.attack);
+    }
+    const Cover_arena arena = make_cover_arena(chart, covers);
+    const Team_metrics metrics = analyze_covers(arena, gyms);
+    ASSERT_EQ(metrics.weakness_union.size(), covers.size());
+
+    uint64_t c = 0;
+    for (const Ranked_set<Type_encoding> &cover : covers)
+    {
+        std::set<Type_encoding> weak{};
+        std::set<Type_encoding> resisted{};
+        std::map<std::string_view, int> singles{};
+        uint32_t quads = 0;
+        for (const Type_encoding &member : cover)
+        {
+            for (const Resistance &r : interactions.at(member))
+            {
+                if (nm < r.multiplier())
+                {
+                    weak.insert(r.type());
+                }
+                if (r.multiplier() < nm)
+                {
+                    resisted.insert(r.type());
+                }
+                quads += r.multiplier() == qd;
+            }
+            const auto [first, second] = member.decode_type();
+            ++singles[first];
+            if (!second.empty())
+            {
+                ++singles[second];
+            }
+        }
+        uint32_t full_gyms = 0;
+        for (const std::set<Type_encoding> &gym : gym_sets)
+        {
+            full_gyms += std::ranges::includes(resisted, gym);
+        }
+        EXPECT_EQ(metrics.weakness_union[c], weak.size());
+        EXPECT_EQ(metrics.quad_weaknesses[c], quads);
+        EXPECT_EQ(metrics.gyms_resisted[c], full_gyms);
+        EXPECT_EQ(metrics.type_overlap[c],
+                  std::ranges::count_if(
+                      singles, [](const auto &s) { return s.second > 1; }));
+        EXPECT_EQ(arena.ranks[c], cover.rank());
+        ++c;
+    }
+
+    std::vector<uint32_t> order{};
+    sort_covers(metrics, gyms_resisted, order);
+    sort_covers(metrics, weakness_union, order);
+    ASSERT_EQ(order.size(), covers.size());
+    for (uint64_t i = 1; i < order.size(); ++i)
+    {
+        const uint32_t a = order[i - 1];
+        const uint32_t b = order[i];
+        EXPECT_EQ(metrics.weakness_union[a] <= metrics.weakness_union[b],
+                  true);
+        if (metrics.weakness_union[a] == metrics.weakness_union[b])
+        {
+            EXPECT_EQ(metrics.gyms_resisted[a] >= metrics.gyms_resisted[b],
+                      true);
+        }
+    }
+    std::vector<uint32_t> kept{};
+    filter_covers(metrics, quad_weaknesses, 0, kept);
+    EXPECT_EQ(kept.size(), static_cast<uint64_t>(std::ranges::count(
+                               metrics.quad_weaknesses, uint32_t{0})));
+}
+
+namespace {
+
+std::set<Ranked_set<Type_encoding>>
+c_api_covers(dl_solver *solver, const dl_results &results)
+{
+    std::set<Ranked_set<Type_encoding>> covers{};
+    for (size_t c = 0; c < results.count; ++c)
+    {
+        std::vector<Type_encoding> members{};
+        for (size_t s = 0; s < results.stride; ++s)
+        {
+            const uint16_t option = results.options[(c * results.stride) + s];
+            if (option == DL_NO_OPTION)
+            {
+                break;
+            }
+            std::array<char, 32> name{};
+            static_cast<void>(dl_type_name(dl_solver_option(solver, option),
+                                           name.data(), name.size()));
+            members.emplace_back(name.data());
+        }
+        covers.insert({results.ranks[c], std::move(members)});
+    }
+    return covers;
+}
+
+} // namespace
+
+TEST(InternalTests, CInterfaceWritesCoversIntoCallerBuffers)
+{
+    dl_generation *galar = nullptr;
+    ASSERT_EQ(dl_generation_load_file("data/dst/Gen-8-Galar.dst", &galar),
+              DL_OK);
+    dl_solver *solver = nullptr;
+    ASSERT_EQ(dl_solver_create(galar, DL_DEFENSE, &solver), DL_OK);
+    dl_generation_free(galar);
+
+    Pokemon_links links(generation_interactions("data/dst/Gen-8-Galar.dst"),
+                        Pokemon_links::defense);
+    std::vector<uint16_t> options(64 * 6);
+    std::vector<int32_t> ranks(64);
+    dl_results results{options.data(), ranks.data(), ranks.size(), 6, 0};
+    EXPECT_EQ(dl_solve(solver, DL_EXACT, 6, &results), DL_OK);
+    EXPECT_EQ(c_api_covers(solver, results), links.exact_coverages_stack(6));
+    EXPECT_FALSE(results.count == 0);
+
+    // The same solver answers again after hiding and unhiding by encoding.
+    const dl_type water = dl_type_from_name("Water");
+    const dl_type fire = dl_type_from_name("Fire");
+    EXPECT_EQ(dl_hide_item(solver, water), DL_OK);
+    EXPECT_EQ(dl_hide_item(solver, fire), DL_OK);
+    EXPECT_EQ(dl_hide_item(solver, fire), DL_ALREADY_HIDDEN);
+    EXPECT_EQ(dl_unhide_item(solver, water), DL_OK);
+    EXPECT_EQ(dl_unhide_item(solver, water), DL_NOT_HIDDEN);
+    EXPECT_EQ(dl_hide_option(solver, dl_type_from_name("Bug-Steel")), DL_OK);
+    EXPECT_EQ(dl_hide_item(solver, dl_type_from_name("Fire-Water")),
+              DL_NOT_FOUND);
+    EXPECT_TRUE(links.hide_requested_item(Type_encoding("Fire")));
+    EXPECT_TRUE(links.hide_requested_option(Type_encoding("Bug-Steel")));
+    EXPECT_EQ(dl_solve(solver, DL_OVERLAPPING, 6, &results), DL_TRUNCATED);
+    EXPECT_EQ(results.count, results.capacity);
+    const std::set<Ranked_set<Type_encoding>> overlapping
+        = links.overlapping_coverages_stack(6);
+    for (const Ranked_set<Type_encoding> &cover : c_api_covers(solver, results))
+    {
+        EXPECT_TRUE(overlapping.contains(cover));
+    }
+    // The links stop at their own output limit even with room to spare.
+    std::vector<uint16_t> roomy_options(250'000 * 6);
+    std::vector<int32_t> roomy_ranks(250'000);
+    dl_results roomy{roomy_options.data(), roomy_ranks.data(),
+                     roomy_ranks.size(), 6, 0};
+    EXPECT_EQ(dl_solve(solver, DL_OVERLAPPING, 6, &roomy), DL_TRUNCATED);
+    EXPECT_LT(roomy.count, roomy.capacity);
+    dl_solver_reset(solver);
+    EXPECT_EQ(dl_unhide_item(solver, fire), DL_NOT_HIDDEN);
+    dl_solver_free(solver);
+
+    // A generation compiled into the caller needs no files.
+    const std::array<dl_interaction, 6> table{{
+        {dl_type_from_name("Grass"), dl_type_from_name("Fire"), DL_DBL},
+        {dl_type_from_name("Grass"), dl_type_from_name("Water"), DL_F12},
+        {dl_type_from_name("Water"), dl_type_from_name("Fire"), DL_F12},
+        {dl_type_from_name("Water"), dl_type_from_name("Water"), DL_F12},
+        {dl_type_from_name("Fire-Water"), dl_type_from_name("Fire"), DL_F14},
+        {dl_type_from_name("Fire-Water"), dl_type_from_name("Water"), DL_NRM},
+    }};
+    dl_generation *tiny = nullptr;
+    ASSERT_EQ(dl_generation_from_table(table.data(), table.size(), &tiny),
+              DL_OK);
+    ASSERT_EQ(dl_solver_create(tiny, DL_DEFENSE, &solver), DL_OK);
+    dl_generation_free(tiny);
+    EXPECT_EQ(dl_solver_num_options(solver), 3U);
+    EXPECT_EQ(dl_solve(solver, DL_EXACT, 2, &results), DL_OK);
+    const std::set<Ranked_set<Type_encoding>> expected{
+        {f12 + f12, {Type_encoding("Water")}},
+        {f14 + f12, {Type_encoding("Fire-Water"), Type_encoding("Grass")}},
+    };
+    EXPECT_EQ(c_api_covers(solver, results), expected);
+    results.stride = 1;
+    EXPECT_EQ(dl_solve(solver, DL_EXACT, 2, &results), DL_INVALID_ARGUMENT);
+    dl_solver_free(solver);
+}
+
+TEST(InternalTests, JsonScanMatchesTheFullParser)
+{
+    for (int gen = 1; gen <= 9; ++gen)
+    {
+        std::istringstream scanned("# " + std::to_string(gen));
+        std::istringstream parsed("# " + std::to_string(gen));
+        EXPECT_EQ(load_interaction_map(scanned, scanned_json),
+                  load_interaction_map(parsed, parsed_json));
+    }
+    for (const std::string map :
+         {"Gen-1-Kanto.dst", "Gen-4-Sinnoh.dst", "Gen-9-Paldea.dst"})
+    {
+        const std::map<std::string, Gym_types> scanned
+            = load_map_gyms(map, scanned_json);
+        const std::map<std::string, Gym_types> parsed
+            = load_map_gyms(map, parsed_json);
+        ASSERT_EQ(scanned.size(), parsed.size());
+        for (const auto &[gym, types] : parsed)
+        {
+            ASSERT_TRUE(scanned.contains(gym));
+            EXPECT_EQ(scanned.at(gym).attack, types.attack);
+            EXPECT_EQ(scanned.at(gym).defense, types.defense);
+        }
+    }
+
+    // Structure inside strings is not structure and strings are views.
+    Json_scan scan(R"({"a{,:]": ["x", "y"], "b": {"c": []}})");
+    ASSERT_TRUE(scan.ok());
+    EXPECT_EQ(scan.num_structurals(), 18U);
+    EXPECT_TRUE(scan.consume('{'));
+    EXPECT_EQ(scan.string(), "a{,:]");
+    EXPECT_TRUE(scan.consume(':'));
+    EXPECT_TRUE(scan.skip_value());
+    EXPECT_TRUE(scan.consume(','));
+    EXPECT_EQ(scan.string(), "b");
+    EXPECT_TRUE(scan.consume(':'));
+    EXPECT_TRUE(scan.skip_value());
+    EXPECT_TRUE(scan.consume('}'));
+    EXPECT_TRUE(scan.at_end());
+    EXPECT_FALSE(Json_scan(R"({"a\"b": []})").ok());
+    EXPECT_FALSE(Json_scan(R"({"open: []})").ok());
+    // A quote on a block boundary keeps the string open into the next block.
+    const std::string padded = std::string(62, ' ') + R"(["long, string"])";
+    Json_scan across(padded);
+    ASSERT_TRUE(across.ok());
+    EXPECT_TRUE(across.consume('['));
+    EXPECT_EQ(across.string(), "long, string");
+    EXPECT_TRUE(across.consume(']'));
+}
+
+TEST(InternalTests, CoverDeltaReportsOnlyChangedOptionSets)
+{
+    Pokemon_links links(generation_interactions("data/dst/Gen-2-Johto.dst"),
+                        Pokemon_links::defense);
+    const std::set<Ranked_set<Type_encoding>> before
+        = links.overlapping_coverages_stack(4);
+    EXPECT_TRUE(links.hide_requested_item(Type_encoding("Ground")));
+    EXPECT_TRUE(links.hide_requested_option(Type_encoding("Flying-Steel")));
+    const std::set<Ranked_set<Type_encoding>> after
+        = links.overlapping_coverages_stack(4);
+
+    // Ranks move when an item leaves so compare member lists alone.
+    const auto members = [](const std::set<Ranked_set<Type_encoding>> &covers) {
+        std::set<std::vector<Type_encoding>> result{};
+        for (const Ranked_set<Type_encoding> &cover : covers)
+        {
+            result.emplace(cover.begin(), cover.end());
+        }
+        return result;
+    };
+    const std::set<std::vector<Type_encoding>> old_members = members(before);
+    const std::set<std::vector<Type_encoding>> new_members = members(after);
+    const Cover_delta delta = cover_delta(links, before, after);
+    std::set<std::vector<Type_encoding>> added{};
+    for (const Ranked_set<Type_encoding> &cover : delta.added)
+    {
+        EXPECT_TRUE(after.contains(cover));
+        EXPECT_FALSE(old_members.contains({cover.begin(), cover.end()}));
+        added.emplace(cover.begin(), cover.end());
+    }
+    std::set<std::vector<Type_encoding>> removed{};
+    for (const Ranked_set<Type_encoding> &cover : delta.removed)
+    {
+        EXPECT_TRUE(before.contains(cover));
+        EXPECT_FALSE(new_members.contains({cover.begin(), cover.end()}));
+        removed.emplace(cover.begin(), cover.end());
+    }
+    EXPECT_EQ(added.size(), delta.added.size());
+    EXPECT_EQ(removed.size(), delta.removed.size());
+    EXPECT_FALSE(delta.added.empty());
+    EXPECT_FALSE(delta.removed.empty());
+    EXPECT_EQ(old_members.size() - removed.size() + added.size(),
+              new_members.size());
+    const Cover_delta none = cover_delta(links, after, after);
+    EXPECT_TRUE(none.added.empty());
+    EXPECT_TRUE(none.removed.empty());
+}
+
+TEST(InternalTests, CombinedGenerationsMatchIntersectedSearches)
+{
+    std::map<int, std::map<Type_encoding, std::set<Resistance>>> generations{};
+    for (const int gen : {2, 3})
+    {
+        std::istringstream header("# " + std::to_string(gen));
+        generations[gen] = load_interaction_map(header);
+    }
+    Pokemon_links combined(generations, Pokemon_links::defense);
+    EXPECT_EQ(combined.get_num_items(), 34U);
+    EXPECT_EQ(combined.item_table().size(),
+              combined.item_generations().size());
+
+    // Without interactions changing between these generations a combined
+    // cover is a cover of each one with every rank counted twice.
+    Pokemon_links johto(generations[2], Pokemon_links::defense);
+    std::set<Ranked_set<Type_encoding>> doubled{};
+    for (const Ranked_set<Type_encoding> &cover :
+         johto.overlapping_coverages_stack(4))
+    {
+        doubled.insert({cover.rank() * 2, {cover.begin(), cover.end()}});
+    }
+    EXPECT_EQ(combined.overlapping_coverages_stack(4), doubled);
+
+    // Hiding by name hides the item in every generation.
+    EXPECT_TRUE(combined.hide_requested_item(Type_encoding("Fire")));
+    EXPECT_FALSE(combined.has_item(Type_encoding("Fire")));
+    EXPECT_EQ(combined.get_num_hid_items(), 2U);
+    combined.reset_items();
+    EXPECT_TRUE(combined.hide_requested_item(3, Type_encoding("Fire")));
+    EXPECT_TRUE(combined.has_item(Type_encoding("Fire")));
+    EXPECT_FALSE(combined.hide_requested_item(3, Type_encoding("Fire")));
+    EXPECT_FALSE(combined.hide_requested_item(9, Type_encoding("Fire")));
+    combined.reset_items();
+
+    // Fairy arrives in generation six so Gen 5 and 6 only share the typings
+    // without it while both charts keep every item of their own.
+    std::map<int, std::map<Type_encoding, std::set<Resistance>>> later{};
+    for (const int gen : {5, 6})
+    {
+        std::istringstream header("# " + std::to_string(gen));
+        later[gen] = load_interaction_map(header);
+    }
+    Pokemon_links across(later, Pokemon_links::defense);
+    EXPECT_EQ(across.get_num_items(), 17U + 18U);
+    EXPECT_EQ(across.get_num_options(), later[5].size());
+    const std::set<Ranked_set<Type_encoding>> covers
+        = across.overlapping_coverages_stack(6);
+    ASSERT_FALSE(covers.empty());
+    const std::set<Type_encoding> team(covers.begin()->begin(),
+                                       covers.begin()->end());
+    for (const int gen : {5, 6})
+    {
+        Pokemon_links single(later[gen], Pokemon_links::defense);
+        single.hide_all_options_except(team);
+        EXPECT_FALSE(single.overlapping_coverages_stack(6).empty());
+    }
+}
+
+TEST(InternalTests, InfeasibleCoreIsMinimal)
+{
+    const Interactions &interactions
+        = generation_interactions("data/dst/Gen-2-Johto.dst");
+    Pokemon_links links(interactions, Pokemon_links::defense);
+    EXPECT_TRUE(infeasible_core(links, 6, true).empty());
+    ASSERT_TRUE(links.overlapping_coverages_stack(2).empty());
+    const std::vector<Type_encoding> core = infeasible_core(links, 2, true);
+    ASSERT_FALSE(core.empty());
+
+    // The core alone is infeasible but every item in it is needed.
+    const auto coverable = [&](const std::set<Type_encoding> &items) {
+        Pokemon_links check(interactions, Pokemon_links::defense);
+        hide_items_except(check, items);
+        return !check.overlapping_coverages_stack(2).empty();
+    };
+    const std::set<Type_encoding> all(core.begin(), core.end());
+    EXPECT_FALSE(coverable(all));
+    for (const Type_encoding &item : core)
+    {
+        std::set<Type_encoding> without = all;
+        without.erase(item);
+        EXPECT_TRUE(coverable(without));
+    }
+
+    // No option left for an item makes that item the whole core.
+    for (const auto &[option, resistances] : interactions)
+    {
+        for (const Resistance &r : resistances)
+        {
+            if (r.type() == Type_encoding("Fire") && r.multiplier() < nrm)
+            {
+                EXPECT_TRUE(links.hide_requested_option(option));
+            }
+        }
+    }
+    EXPECT_EQ(infeasible_core(links, 6, true),
+              std::vector<Type_encoding>{Type_encoding("Fire")});
+    EXPECT_EQ(infeasible_core(links, 6, false),
+              std::vector<Type_encoding>{Type_encoding("Fire")});
+}
+
+TEST(InternalTests, MultiQueryMatchesOneSearchPerQuery)
+{
+    const Sweep_map paldea = load_sweep_map("data/dst/Gen-9-Paldea.dst");
+    // More than one walk of 64 queries and a query that stops early.
+    std::vector<std::set<Type_encoding>> queries{};
+    for (uint64_t i = 1; i <= 70; ++i)
+    {
+        std::set<Type_encoding> &items = queries.emplace_back();
+        const uint64_t gyms = i ^ (i >> 1);
+        for (uint64_t gym = 0; gym < paldea.gyms.size(); ++gym)
+        {
+            if (gyms & (uint64_t{1} << gym))
+            {
+                items.insert(paldea.gym_types[gym].attack.begin(),
+                             paldea.gym_types[gym].attack.end());
+            }
+        }
+    }
+    queries.push_back({});
+    Pokemon_links links(paldea.interactions, Pokemon_links::defense);
+    for (const auto &[overlapping, depth] : {std::pair{false, 3},
+                                             std::pair{true, 2}})
+    {
+        std::vector<std::set<Ranked_set<Type_encoding>>> streams(
+            queries.size());
+        const std::vector<uint64_t> found = multi_query_coverages(
+            links, queries, depth, overlapping,
+            [&](uint64_t q, const Ranked_set<Type_encoding> &cover) {
+                EXPECT_TRUE(streams[q].insert(cover).second);
+                return q != 3;
+            });
+        ASSERT_EQ(found.size(), queries.size());
+        EXPECT_EQ(found[3], 1U);
+        EXPECT_EQ(found.back(), 0U);
+        for (uint64_t q = 0; q + 1 < queries.size(); ++q)
+        {
+            Pokemon_links single(paldea.interactions, Pokemon_links::defense);
+            hide_items_except(single, queries[q]);
+            single.set_item_heuristic(Pokemon_links::first_item);
+            const std::set<Ranked_set<Type_encoding>> expected
+                = overlapping ? single.overlapping_coverages_stack(depth)
+                              : single.exact_coverages_stack(depth);
+            EXPECT_EQ(found[q], streams[q].size());
+            if (q != 3)
+            {
+                EXPECT_EQ(streams[q], expected);
+            }
+        }
+    }
+}
+
+TEST(InternalTests, DemandCoversMeetEveryDemand)
+{
+    const Interactions &interactions
+        = generation_interactions("data/dst/Gen-2-Johto.dst");
+    Pokemon_links links(interactions, Pokemon_links::defense);
+    const std::set<Type_encoding> wanted{Type_encoding("Ground"),
+                                         Type_encoding("Fire"),
+                                         Type_encoding("Ice")};
+    hide_items_except(links, wanted);
+    EXPECT_EQ(demand_weight(Pokemon_links::defense, imm), 3);
+    EXPECT_EQ(demand_weight(Pokemon_links::defense, nrm), 0);
+    EXPECT_EQ(demand_weight(Pokemon_links::attack, qdr), 2);
+
+    // An immunity or two resistances to Ground.
+    const std::map<Type_encoding, int> demands{{Type_encoding("Ground"), 2}};
+    const std::set<Ranked_set<Type_encoding>> covers
+        = demand_coverages(links, demands, 1, 3);
+    ASSERT_FALSE(covers.empty());
+    const auto weights = [&](const std::vector<Type_encoding> &team) {
+        std::map<Type_encoding, int> met{};
+        int rank = 0;
+        for (const Type_encoding &member : team)
+        {
+            for (const Resistance &r : interactions.at(member))
+            {
+                if (wanted.contains(r.type()) && r.multiplier() < nrm)
+                {
+                    met[r.type()] += demand_weight(Pokemon_links::defense,
+                                                   r.multiplier());
+                    rank += r.multiplier();
+                }
+            }
+        }
+        return std::make_pair(met, rank);
+    };
+    const auto meets = [&](const std::map<Type_encoding, int> &met) {
+        return met.contains(Type_encoding("Ground"))
+               && met.at(Type_encoding("Ground")) >= 2
+               && met.contains(Type_encoding("Fire"))
+               && met.contains(Type_encoding("Ice"));
+    };
+    std::set<std::vector<Type_encoding>> found{};
+    for (const Ranked_set<Type_encoding> &cover : covers)
+    {
+        const std::vector<Type_encoding> team(cover.begin(), cover.end());
+        EXPECT_LE(team.size(), 3U);
+        const auto [met, rank] = weights(team);
+        EXPECT_TRUE(meets(met));
+        EXPECT_EQ(cover.rank(), rank);
+        EXPECT_TRUE(found.insert(team).second);
+    }
+
+    // Every team of three or fewer that needs all its members is found.
+    const std::vector<Type_encoding> all = links.get_options();
+    uint64_t minimal = 0;
+    for (uint64_t a = 0; a < all.size(); ++a)
+    {
+        for (uint64_t b = a; b < all.size(); ++b)
+        {
+            for (uint64_t c = b; c < all.size(); ++c)
+            {
+                std::set<Type_encoding> unique{all[a], all[b], all[c]};
+                const std::vector<Type_encoding> team(unique.begin(),
+                                                      unique.end());
+                if (team.size() != 1U + (a != b) + (b != c)
+                    || !meets(weights(team).first))
+                {
+                    continue;
+                }
+                bool needs_all = true;
+                for (uint64_t skip = 0; skip < team.size(); ++skip)
+                {
+                    std::vector<Type_encoding> smaller = team;
+                    smaller.erase(smaller.begin()
+                                  + static_cast<std::ptrdiff_t>(skip));
+                    needs_all = needs_all && !meets(weights(smaller).first);
+                }
+                if (needs_all)
+                {
+                    ++minimal;
+                    EXPECT_TRUE(found.contains(team));
+                }
+            }
+        }
+    }
+    EXPECT_GT(minimal, 0U);
+}
+
+TEST(InternalTests, DisjointTeamsArePackedOnce)
+{
+    const Interactions &interactions
+        = generation_interactions("data/dst/Gen-9-Paldea.dst");
+    Pokemon_links links(interactions, Pokemon_links::defense);
+    const auto disjoint_pairs
+        = [](const std::vector<Ranked_set<Type_encoding>> &teams) {
+              uint64_t pairs = 0;
+              for (uint64_t a = 0; a < teams.size(); ++a)
+              {
+                  for (uint64_t b = a + 1; b < teams.size(); ++b)
+                  {
+                      pairs += std::ranges::none_of(
+                          teams[a], [&](const Type_encoding &t) {
+                              return std::ranges::binary_search(teams[b], t);
+                          });
+                  }
+              }
+              return pairs;
+          };
+    const std::set<Ranked_set<Type_encoding>> singles
+        = links.exact_coverages_stack(6);
+    std::vector<Ranked_set<Type_encoding>> one_team{};
+    for (const std::vector<Ranked_set<Type_encoding>> &packing :
+         disjoint_coverages(links, 1, 6, false))
+    {
+        one_team.push_back(packing.front());
+    }
+    EXPECT_EQ(std::set(one_team.begin(), one_team.end()), singles);
+
+    // Pairing the separate results is the slow way to the same answer.
+    const std::vector<std::vector<Ranked_set<Type_encoding>>> packings
+        = disjoint_coverages(links, 2, 6, false);
+    EXPECT_GT(packings.size(), 0U);
+    EXPECT_EQ(packings.size(),
+              disjoint_pairs({singles.begin(), singles.end()}));
+    std::set<std::vector<Ranked_set<Type_encoding>>> unique{};
+    for (const std::vector<Ranked_set<Type_encoding>> &packing : packings)
+    {
+        ASSERT_EQ(packing.size(), 2U);
+        EXPECT_TRUE(singles.contains(packing[0]));
+        EXPECT_TRUE(singles.contains(packing[1]));
+        EXPECT_TRUE(unique.insert(packing).second);
+    }
+
+    // Overlapping teams may each cover an item more than once.
+    const Interactions &gen_two
+        = generation_interactions("data/dst/Gen-2-Johto.dst");
+    Pokemon_links loose_links(gen_two, Pokemon_links::defense);
+    std::vector<Ranked_set<Type_encoding>> loose_teams{};
+    for (const std::vector<Ranked_set<Type_encoding>> &packing :
+         disjoint_coverages(loose_links, 1, 3, true))
+    {
+        loose_teams.push_back(packing.front());
+    }
+    const std::vector<std::vector<Ranked_set<Type_encoding>>> loose
+        = disjoint_coverages(loose_links, 2, 3, true);
+    EXPECT_GT(loose.size(), 0U);
+    EXPECT_EQ(loose.size(), disjoint_pairs(loose_teams));
+    for (const std::vector<Ranked_set<Type_encoding>> &packing : loose)
+    {
+        std::set<Type_encoding> used{};
+        for (const Ranked_set<Type_encoding> &team : packing)
+        {
+            EXPECT_LE(team.size(), 3U);
+            std::set<Type_encoding> covered{};
+            for (const Type_encoding &member : team)
+            {
+                EXPECT_TRUE(used.insert(member).second);
+                for (const Resistance &r : gen_two.at(member))
+                {
+                    if (r.multiplier() < nrm)
+                    {
+                        covered.insert(r.type());
+                    }
+                }
+            }
+            EXPECT_EQ(covered.size(), loose_links.get_num_items());
+        }
+    }
+}
+
+TEST(InternalTests, CoverageServiceSolvesEachQueryOnce)
+{
+    const Interactions &interactions
+        = generation_interactions("data/dst/Gen-9-Paldea.dst");
+    Coverage_service service(2);
+    service.add_generation(9, interactions);
+    const Coverage_query query{9, Pokemon_links::defense, false, {}, {}, 6};
+
+    std::vector<Shared_covers> answers(8);
+    std::vector<std::thread> threads{};
+    for (uint64_t t = 0; t < answers.size(); ++t)
+    {
+        threads.emplace_back([&service, &answers, &query, t] {
+            answers[t] = service.solve(query);
+        });
+    }
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+    EXPECT_EQ(service.num_solves(), 1U);
+    ASSERT_NE(answers[0], nullptr);
+    for (const Shared_covers &answer : answers)
+    {
+        EXPECT_EQ(answer, answers[0]);
+    }
+    Pokemon_links links(interactions, Pokemon_links::defense);
+    EXPECT_EQ(*answers[0], links.exact_coverages_stack(6));
+
+    // A full mask is the same question as an empty one.
+    Coverage_query spelled_out = query;
+    spelled_out.live_items.assign(links.get_num_items(), true);
+    spelled_out.live_options.assign(links.option_table().size() - 1, true);
+    EXPECT_EQ(service.solve(spelled_out), answers[0]);
+    EXPECT_EQ(service.num_solves(), 1U);
+
+    // Hiding an item is a new question with the answer the links give.
+    const std::vector<Type_encoding> items = links.get_items();
+    const auto fire = static_cast<uint64_t>(
+        std::ranges::find(items, Type_encoding("Fire")) - items.begin());
+    ASSERT_LT(fire, items.size());
+    Coverage_query no_fire = spelled_out;
+    no_fire.live_items[fire] = false;
+    const Shared_covers fireless = service.solve(no_fire);
+    ASSERT_NE(fireless, nullptr);
+    std::vector<bool> live(links.get_num_items(), true);
+    live[fire] = false;
+    EXPECT_TRUE(links.set_live_items(live));
+    EXPECT_EQ(*fireless, links.exact_coverages_stack(6));
+    EXPECT_EQ(service.num_solves(), 2U);
+
+    // A third answer pushes out the least recently used one.
+    static_cast<void>(service.solve(query));
+    Coverage_query attack = query;
+    attack.type = Pokemon_links::attack;
+    attack.depth = 24;
+    EXPECT_NE(service.solve(attack), nullptr);
+    EXPECT_EQ(service.num_cached(), 2U);
+    EXPECT_EQ(service.num_solves(), 3U);
+    EXPECT_EQ(service.solve(query), answers[0]);
+    EXPECT_EQ(service.num_solves(), 3U);
+    EXPECT_NE(service.solve(no_fire), fireless);
+    EXPECT_EQ(service.num_solves(), 4U);
+
+    Coverage_query unknown = query;
+    unknown.generation = 1;
+    EXPECT_EQ(service.solve(unknown), nullptr);
+    Coverage_query short_mask = query;
+    short_mask.live_items.assign(3, true);
+    EXPECT_EQ(service.solve(short_mask), nullptr);
+}
+
+TEST(InternalTests, CoverageServiceForgetsSearchesOfAReplacedGeneration)
+{
+    const Interactions &paldea
+        = generation_interactions("data/dst/Gen-9-Paldea.dst");
+    const Interactions &kanto
+        = generation_interactions("data/dst/Gen-1-Kanto.dst");
+    Coverage_service service(4);
+    service.add_generation(9, paldea);
+    // Long enough that the generation is replaced while it runs.
+    const Coverage_query query{9, Pokemon_links::defense, true, {}, {}, 6};
+    Shared_covers old_answer{};
+    std::thread slow([&service, &old_answer, &query] {
+        old_answer = service.solve(query);
+    });
+    while (service.num_solves() == 0)
+    {
+        std::this_thread::yield();
+    }
+    service.add_generation(9, kanto);
+    // The same question is asked of the new links, not of the old search.
+    const Shared_covers new_answer = service.solve(query);
+    slow.join();
+    ASSERT_NE(old_answer, nullptr);
+    ASSERT_NE(new_answer, nullptr);
+    EXPECT_EQ(service.num_solves(), 2U);
+    Pokemon_links old_links(paldea, Pokemon_links::defense);
+    Pokemon_links new_links(kanto, Pokemon_links::defense);
+    EXPECT_EQ(*old_answer, old_links.overlapping_coverages_stack(6));
+    EXPECT_EQ(*new_answer, new_links.overlapping_coverages_stack(6));
+    // The stale answer was never cached over the new one.
+    EXPECT_EQ(service.solve(query), new_answer);
+    EXPECT_EQ(service.num_cached(), 1U);
+    EXPECT_EQ(service.num_solves(), 2U);
+}
+
+TEST(InternalTests, TrailEngineMatchesStackEngine)
+{
+    const Interactions &gen_two
+        = generation_interactions("data/dst/Gen-2-Johto.dst");
+    const Interactions &gen_eight
+        = generation_interactions("data/dst/Gen-8-Galar.dst");
+    std::vector<Pokemon_links> problems{};
+    problems.emplace_back(gen_two, Pokemon_links::defense);
+    problems.emplace_back(gen_eight, Pokemon_links::defense);
+    problems.emplace_back(gen_eight, Pokemon_links::attack);
+    problems.emplace_back(gen_two, Pokemon_links::defense, f2);
+    // Team rules bring in secondary items and colors.
+    problems.emplace_back(
+        gen_eight, std::vector<Pokemon_links::Team_rule>{
+                       {Pokemon_links::distinct_types},
+                       {Pokemon_links::one_weak_to, Type_encoding("Ground")},
+                       {Pokemon_links::same_weakness_to, Type_encoding("Ice")},
+                       {Pokemon_links::no_quad_weakness},
+                   });
+    Pokemon_links hidden(gen_eight, Pokemon_links::defense);
+    EXPECT_TRUE(hide_item(hidden, Type_encoding("Fire")));
+    EXPECT_TRUE(hide_option(hidden, Type_encoding("Ghost")));
+    problems.push_back(hidden);
+    for (Pokemon_links &links : problems)
+    {
+        const std::vector<Pokemon_links::Poke_link> original = links.links();
+        const int depth
+            = links.get_links_type() == Pokemon_links::attack ? 24 : 6;
+        EXPECT_EQ(exact_cover_trail(links, depth),
+                  exact_cover_stack(links, depth));
+        EXPECT_EQ(links.links(), original);
+        EXPECT_EQ(overlapping_cover_trail(links, 3),
+                  overlapping_cover_stack(links, 3));
+        EXPECT_EQ(links.links(), original);
+    }
+
+    // Stopping deep in the search unwinds to the root in one undo.
+    Pokemon_links limited(gen_eight, Pokemon_links::defense);
+    const std::vector<Pokemon_links::Poke_link> original = limited.links();
+    const std::vector<Pokemon_links::Type_name> items = limited.item_table();
+    set_output_limit(limited, 5);
+    EXPECT_EQ(overlapping_cover_trail(limited, 6).size(), 5U);
+    EXPECT_EQ(search_status(limited), Pokemon_links::output_limit);
+    EXPECT_EQ(limited.links(), original);
+    EXPECT_EQ(limited.item_table(), items);
+
+    const Portfolio_result raced = portfolio_best_covers(
+        problems[1], false, 6, 3,
+        {{Pokemon_links::fewest_options, Pokemon_links::built_order,
+          trail_engine}});
+    EXPECT_EQ(raced.status, Pokemon_links::complete);
+    EXPECT_EQ(raced.winner.engine, trail_engine);
+    EXPECT_EQ(raced.covers.empty(), false);
+}
+
+TEST(InternalTests, UniqueOverlappingCoversAreFoundOnce)
+{
+    const Interactions &gen_two
+        = generation_interactions("data/dst/Gen-2-Johto.dst");
+    Pokemon_links links(gen_two, Pokemon_links::defense);
+    const std::vector<Pokemon_links::Poke_link> original = links.links();
+    const std::set<Ranked_set<Type_encoding>> stack
+        = overlapping_cover_stack(links, 4);
+    const std::vector<Ranked_set<Type_encoding>> unique
+        = overlapping_cover_unique(links, 4);
+    EXPECT_EQ(links.links(), original);
+    const std::set<Ranked_set<Type_encoding>> unique_set(unique.begin(),
+                                                         unique.end());
+    EXPECT_EQ(unique_set.size(), unique.size());
+    EXPECT_TRUE(std::ranges::includes(stack, unique_set));
+
+    // The rank of an overlapping cover depends on the order it was built in
+    // so the stack search may hold a team more than once. Teams are compared
+    // by their members.
+    const auto team_members = [](const auto &covers) {
+        std::set<std::vector<Type_encoding>> teams{};
+        for (const Ranked_set<Type_encoding> &cover : covers)
+        {
+            teams.emplace(cover.begin(), cover.end());
+        }
+        return teams;
+    };
+    EXPECT_EQ(team_members(unique), team_members(stack));
+    EXPECT_EQ(team_members(unique).size(), unique.size());
+
+    // Team rules splice links during an overlapping search too.
+    const Interactions &gen_eight
+        = generation_interactions("data/dst/Gen-8-Galar.dst");
+    Pokemon_links ruled(
+        gen_eight, std::vector<Pokemon_links::Team_rule>{
+                       {Pokemon_links::distinct_types},
+                       {Pokemon_links::same_weakness_to, Type_encoding("Ice")},
+                   });
+    const std::vector<Pokemon_links::Poke_link> ruled_links = ruled.links();
+    const std::vector<Ranked_set<Type_encoding>> ruled_unique
+        = overlapping_cover_unique(ruled, 3);
+    const std::set<Ranked_set<Type_encoding>> ruled_set(ruled_unique.begin(),
+                                                        ruled_unique.end());
+    EXPECT_EQ(ruled_set.size(), ruled_unique.size());
+    const std::set<Ranked_set<Type_encoding>> ruled_stack
+        = overlapping_cover_stack(ruled, 3);
+    EXPECT_TRUE(std::ranges::includes(ruled_stack, ruled_set));
+    EXPECT_EQ(team_members(ruled_unique), team_members(ruled_stack));
+    EXPECT_EQ(team_members(ruled_unique).size(), ruled_unique.size());
+    EXPECT_EQ(ruled.links(), ruled_links);
+
+    set_output_limit(links, 5);
+    EXPECT_EQ(overlapping_cover_unique(links, 4).size(), 5U);
+    EXPECT_EQ(search_status(links), Pokemon_links::output_limit);
+    EXPECT_EQ(links.links(), original);
+}
+
 } // namespace Dancing_links